@@ -0,0 +1,22 @@
+#!/bin/sh
+# Sirf builtins wale while loop ka per-iteration cost (loop ek hi baar parse hota hai).
+# Usage: bench/loop_bench.sh [iterations]   (ISHELL=path se doosri binary)
+N=${1:-1000000}
+ISHELL=${ISHELL:-./ishell}
+SCRIPT='i=0; while [ $i -lt '"$N"' ]; do i=$((i + 1)); : ; done'
+
+now_ns() { date +%s%N; }
+
+run() {
+    label=$1; shift
+    start=$(now_ns)
+    "$@" -c "$SCRIPT" || exit 1
+    end=$(now_ns)
+    total=$((end - start))
+    echo "$label: $N iterations in $((total / 1000000)) ms, $((total / N)) ns/iteration"
+}
+
+run ishell "$ISHELL"
+if [ -n "$COMPARE" ] && command -v "$COMPARE" >/dev/null 2>&1; then
+    run "$COMPARE" "$COMPARE"
+fi
@@ -0,0 +1,21 @@
+#!/bin/sh
+# ishell-replay se interactive latency: keystroke se echo tak aur Enter se agle prompt tak.
+# Usage: bench/replay_bench.sh [session.rec]   (ISHELL / REPLAY / ROUNDS override)
+# Session na di ho to ek typed script ROUNDS baar chalti hai (-e).
+ISHELL=${ISHELL:-./ishell}
+REPLAY=${REPLAY:-./ishell-replay}
+ROUNDS=${ROUNDS:-20}
+
+# Recorded session diya ho to wahi replay karo
+if [ -n "$1" ]; then
+    exec "$REPLAY" -s "$ISHELL" "$1"
+fi
+
+# Typed script: har round mein builtin, redirection, arithmetic aur cd
+text=''
+i=0
+while [ $i -lt "$ROUNDS" ]; do
+    text="${text}echo round $i\\nls > /dev/null\\nx=\$((x + 1)); pwd\\ncd /tmp; cd -\\n"
+    i=$((i + 1))
+done
+exec "$REPLAY" -s "$ISHELL" -e "${text}exit\\n"
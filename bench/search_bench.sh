@@ -0,0 +1,55 @@
+#!/bin/sh
+# Synthetic log corpus par 'search -c' ka throughput (grep -rnF se comparison).
+# Usage: bench/search_bench.sh [size_mb]   (ISHELL / CORPUS / NEEDLE override)
+# Corpus ek baar banta hai aur CORPUS dir mein reuse hota hai.
+SIZE_MB=${1:-2048}
+ISHELL=${ISHELL:-./ishell}
+CORPUS=${CORPUS:-${TMPDIR:-/tmp}/ishell-search-corpus.$SIZE_MB}
+NEEDLE=${NEEDLE:-'deadbeef-needle'}
+FILES=16
+
+now_ns() { date +%s%N; }
+
+report() {
+    echo "$1: $(($2 / 1000000)) ms, $((SIZE_MB * 1000000000 / $2)) MB/s, $3 matching lines"
+}
+
+if [ ! -f "$CORPUS/.done" ]; then
+    mkdir -p "$CORPUS/logs" "$CORPUS/bin" || exit 1
+    # 1 MiB ka log block; har file isi block ki copies + kuch needle lines
+    awk 'BEGIN { srand(7); n = 0
+        while (n < 1048576) {
+            line = sprintf("2024-01-%02d %02d:%02d:%02d worker-%d INFO request id=%08x took %dms path=/api/v%d/items",
+                int(rand() * 28) + 1, int(rand() * 24), int(rand() * 60), int(rand() * 60),
+                int(rand() * 64), int(rand() * 2147483647), int(rand() * 900), int(rand() * 3))
+            print line; n += length(line) + 1 } }' > "$CORPUS/block" || exit 1
+    per_file=$((SIZE_MB / FILES))
+    f=0
+    while [ $f -lt $FILES ]; do
+        out="$CORPUS/logs/app-$f.log"
+        : > "$out"
+        i=0
+        while [ $i -lt $per_file ]; do
+            cat "$CORPUS/block" >> "$out"
+            [ $((i % 97)) -eq 13 ] && echo "2024-01-01 00:00:00 worker-1 ERROR $NEEDLE at block $i" >> "$out"
+            i=$((i + 1))
+        done
+        f=$((f + 1))
+    done
+    printf "binary\000$NEEDLE\n" > "$CORPUS/bin/blob.dat"
+    rm -f "$CORPUS/block"
+    touch "$CORPUS/.done"
+fi
+
+# Warm page cache: dono tools same state mein chalein
+cat "$CORPUS"/logs/* > /dev/null
+
+start=$(now_ns)
+lines=$("$ISHELL" -c "search -c '$NEEDLE' '$CORPUS'" | wc -l)
+report "ishell search -c" $(($(now_ns) - start)) "$lines"
+
+if command -v grep >/dev/null 2>&1; then
+    start=$(now_ns)
+    lines=$(grep -rnF --binary-files=without-match "$NEEDLE" "$CORPUS" | wc -l)
+    report "grep -rnF" $(($(now_ns) - start)) "$lines"
+fi
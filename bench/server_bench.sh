@@ -0,0 +1,42 @@
+#!/bin/sh
+# Per-request latency: har baar cold 'ishell -c' vs ek warm 'ishell --server'.
+# Usage: bench/server_bench.sh [requests]   (ISHELL / CLIENT / SCRIPT override)
+N=${1:-500}
+ISHELL=${ISHELL:-./ishell}
+CLIENT=${CLIENT:-./ishell-client}
+SCRIPT=${SCRIPT:-'echo hi; /bin/true'}
+SOCK=${TMPDIR:-/tmp}/ishell-bench.$$.sock
+
+now_ns() { date +%s%N; }
+
+report() {
+    echo "$1: $N requests in $(($2 / 1000000)) ms, $(($2 / N / 1000)) us/request"
+}
+
+start=$(now_ns)
+i=0
+while [ $i -lt "$N" ]; do
+    "$ISHELL" -c "$SCRIPT" >/dev/null || exit 1
+    i=$((i + 1))
+done
+report "cold ishell -c" $(($(now_ns) - start))
+
+"$ISHELL" --server "$SOCK" 2>/dev/null &
+SERVER=$!
+trap 'kill $SERVER 2>/dev/null' EXIT
+while [ ! -S "$SOCK" ]; do sleep 0.01; done
+
+start=$(now_ns)
+i=0
+while [ $i -lt "$N" ]; do
+    "$CLIENT" -s "$SOCK" "$SCRIPT" >/dev/null || exit 1
+    i=$((i + 1))
+done
+report "server, client per request" $(($(now_ns) - start))
+
+printf "server, one connection: "
+"$CLIENT" -s "$SOCK" -n "$N" -q "$SCRIPT" 2>&1
+
+# Request ke baad half-close (shutdown(SHUT_WR)) karne wale client ko bhi poora response milna chahiye
+out=$("$CLIENT" -s "$SOCK" -w 'sleep 0.1; echo ok') || exit 1
+echo "server, half-closed client: $out"
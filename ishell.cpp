@@ -21,7 +21,37 @@
 #include <signal.h>
 #include <errno.h>
 #include <limits.h>
+#include <sys/inotify.h>
+#include <sys/syscall.h>
+#include <sys/resource.h>
+#include <sched.h>
+#include <sys/ioctl.h>
+#include <unordered_map>
+#include <memory>
+#include <fnmatch.h>
 #include <cctype>       // for isdigit(), isspace() 
+#include <cstddef>
+#include <new>
+#include <atomic>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <poll.h>
+#include <sys/mman.h>
+#include <sys/timerfd.h>
+#include <sys/uio.h>
+#include <cstdint>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>   // completion scorer, content search (SSE2/AVX2)
+#define ISHELL_X86_SIMD 1
+#else
+#define ISHELL_X86_SIMD 0
+#endif
+#include "server_protocol.h"
+#include "session_record.h"
 
 using namespace std;
 
@@ -34,56 +64,385 @@ using namespace std;
 #define COLOR_CYAN     "\033[36m"  
 #define COLOR_RESET    "\033[0m"   
 
+// ===================== Per-Command Arena =====================
+
+// Monotonic arena: ek input line ka saara parse aur launch data yahin se
+// carve hota hai. Line khatam hone par reset() sab kuch ek step mein release
+// kar deta hai. Blocks free nahi hote, agli line unhe reuse karti hai, isliye
+// steady state mein koi malloc nahi hota.
+class Arena {
+    struct Block;
+public:
+    struct Mark {
+        Block *block;
+        char *ptr;
+    };
+
+    explicit Arena(size_t blockSize = 16 * 1024)
+        : head(nullptr), cur(nullptr), ptr(nullptr), end(nullptr), blockSize(blockSize) {}
+    ~Arena();
+
+    void *allocate(size_t n, size_t align = alignof(max_align_t));
+    char *copy(const char *s, size_t n);        // NUL-terminated copy
+    Mark mark() const { Mark m; m.block = cur; m.ptr = ptr; return m; }
+    void rewind(const Mark &m);
+    void reset();
+    size_t capacity() const;
+
+private:
+    struct Block {
+        Block *next;
+        size_t size;
+        char *data() { return reinterpret_cast<char*>(this + 1); }
+    };
+    Block *head, *cur;
+    char *ptr, *end;
+    size_t blockSize;
+    static const size_t MAX_RETAINED_BLOCK = 1024 * 1024;
+
+    void nextBlock(size_t need);
+    Arena(const Arena &) = delete;
+    Arena &operator=(const Arena &) = delete;
+};
+
+extern Arena *currentArena;
+
+// STL containers ke liye allocator jo currentArena se memory leta hai.
+// deallocate() no-op hai; memory arena reset/rewind par wapas milti hai.
+template <class T>
+struct ArenaAllocator {
+    typedef T value_type;
+    Arena *arena;
+
+    ArenaAllocator() : arena(currentArena) {}
+    explicit ArenaAllocator(Arena *a) : arena(a) {}
+    template <class U>
+    ArenaAllocator(const ArenaAllocator<U> &other) : arena(other.arena) {}
+
+    T *allocate(size_t n) { return static_cast<T*>(arena->allocate(n * sizeof(T), alignof(T))); }
+    void deallocate(T *, size_t) {}
+};
+
+template <class T, class U>
+bool operator==(const ArenaAllocator<T> &a, const ArenaAllocator<U> &b) { return a.arena == b.arena; }
+template <class T, class U>
+bool operator!=(const ArenaAllocator<T> &a, const ArenaAllocator<U> &b) { return a.arena != b.arena; }
+
+typedef basic_string<char, char_traits<char>, ArenaAllocator<char>> ArenaString;
+typedef vector<ArenaString, ArenaAllocator<ArenaString>> TokenList;
+typedef vector<char*, ArenaAllocator<char*>> ArgVector;
+
+// Scope khatam hone par arena ko wapas mark par le jata hai (loop iterations,
+// har simple command ki expansion isi se reuse hoti hai).
+class ArenaScope {
+public:
+    explicit ArenaScope(Arena *a = currentArena) : arena(a), mark(a->mark()) {}
+    ~ArenaScope() { arena->rewind(mark); }
+private:
+    Arena *arena;
+    Arena::Mark mark;
+    ArenaScope(const ArenaScope &) = delete;
+    ArenaScope &operator=(const ArenaScope &) = delete;
+};
+
+// ===================== Shell Language: AST =====================
+
+// Parser input text ko ek baar in nodes mein badalta hai; loops aur functions
+// har iteration par seedha yahi tree execute karte hain (koi re-lexing nahi).
+// Saare nodes arena mein rehte hain aur trivially destructible hain.
+
+enum WordPartKind { WP_LITERAL, WP_PARAM, WP_ARITH, WP_COMMAND };
+
+struct Node;
+
+struct WordPart {
+    WordPartKind kind;
+    bool quoted;            // double quotes ke andar (field splitting nahi)
+    const char *text;       // literal text / parameter name / arithmetic expression / command source
+    size_t len;
+    Node *program;          // WP_COMMAND: $(...) / `...` ka parsed body
+    WordPart *next;
+};
+
+struct Word {
+    WordPart *parts;
+    const char *raw;        // source text (reserved words pehchanne ke liye)
+    size_t rawLen;
+    bool plain;             // koi quote, escape ya expansion nahi
+    bool hasQuotes;         // "" bhi ek (khali) field deta hai
+    const char *assignName; // NAME=value prefix ho to NAME
+    Word *next;
+};
+
+enum RedirKind { R_IN, R_OUT, R_APPEND, R_DUP };
+
+struct Redir {
+    RedirKind kind;
+    int fd;                 // kaunsa fd redirect hota hai
+    Word *target;           // file name, ya R_DUP ke liye fd number
+    Redir *next;
+};
+
+struct Node;
+
+struct CaseItem {
+    Word *patterns;
+    Node *body;
+    CaseItem *next;
+};
+
+enum NodeKind {
+    N_SIMPLE, N_PIPELINE, N_AND, N_OR, N_GROUP, N_SUBSHELL,
+    N_IF, N_WHILE, N_UNTIL, N_FOR, N_CASE, N_FUNCDEF
+};
+
+struct Node {
+    NodeKind kind;
+    bool background;        // '&' se khatam
+    bool negate;            // '! pipeline'
+    bool hasItems;          // for: 'in' diya gaya tha
+    Node *next;             // list mein agla command / pipeline ka agla stage
+    Word *assigns;          // simple: NAME=value prefixes
+    Word *words;            // simple: argv; for: items; case: subject
+    Redir *redirs;
+    Node *cond;             // if/while condition, and/or left, pipeline/group first node
+    Node *body;             // then/do body, and/or right, function body
+    Node *elseBody;         // else (elif ek nested N_IF hai)
+    const char *name;       // for variable / function name
+    CaseItem *cases;
+};
+
+// Function body apne arena mein clone hoti hai taaki line ka arena reset
+// hone ke baad bhi zinda rahe.
+struct ShellFunction {
+    Arena arena;
+    Node *body;
+    ShellFunction() : arena(4096), body(nullptr) {}
+};
+
+// 'alias name=value': value ek baar simple command ke words mein parse hota hai
+struct ShellAlias {
+    Arena arena;
+    string value;           // jaisa define kiya (alias listing ke liye)
+    Word *words;            // command position par inhe expand karo
+    ShellAlias() : arena(1024), words(nullptr) {}
+};
+
 // --- Global Variables ---
 
 // History file aur maximum history size
-const string HISTORY_FILE = ".shell_history";
+const char *const HISTORY_FILE = ".shell_history";  // $HOME ke andar (per-user)
 const size_t MAX_HISTORY_SIZE = 20;
+const size_t HISTORY_TAIL_BYTES = 64 * 1024;        // startup par sirf itna tail padho
 list<string> history;              // command history ki list
 vector<string> historyVector;      // vector mein history (for easy access)
+string historyPath;                // resolved history file path
+int historyFd = -1;                // O_APPEND fd, records isi se likhe/padhe jate hain
+int historyWatchFd = -1;           // inotify fd (dusre sessions ke appends)
+off_t historyOffset = 0;           // file mein kahan tak records padh liye
 string prevDirectory;              // last directory remember karne ke liye
 volatile pid_t fg_pid = 0;         // current foreground process id
+volatile sig_atomic_t interruptRequested = 0;  // Ctrl-C jab koi fg process nahi (builtin loops ke liye)
 struct termios orig_termios;       
+Arena commandArena;                // per-line arena, main loop har line ke baad reset karta hai
+Arena *currentArena = &commandArena;
+bool allocStats = false;           // ISHELL_ALLOC_STATS set ho to har line ke allocations print karo
+bool promptMarks = false;          // ISHELL_PROMPT_MARKS / --record: prompt par OSC 133 marks (ishell-replay ke liye)
+atomic<size_t> allocCount(0);      // operator new calls (instrumentation)
+atomic<size_t> allocBytes(0);      // operator new bytes (instrumentation)
+bool terminalConfigured = false;   // non-canonical mode set hua tha (reset tabhi karo)
+unordered_map<string, string> shellVars;                       // shell variables
+unordered_map<string, shared_ptr<ShellFunction>> functions;    // defined functions
+unordered_map<string, shared_ptr<ShellAlias>> aliases;         // alias/unalias table
+int lastStatus = 0;                // $?
+int lastSubstStatus = 0;           // aakhri $(...) ka status (sirf-assignment command ka status)
+bool expansionFailed = false;       // $((...)) error: current command nahi chalta, status 1
+const char *scriptName = "ishell"; // $0
+char **positionalArgs = nullptr;   // $1.. (function call ya script args)
+int positionalCount = 0;           // $#
+int loopDepth = 0;                 // kitne loops ke andar hain
+int breakLevels = 0;               // pending 'break N'
+int continueLevels = 0;            // pending 'continue N'
+bool returnRequested = false;      // function se 'return'
+int functionDepth = 0;
+const int MAX_FUNCTION_DEPTH = 1000;
+enum OutputFormat { OUT_TEXT, OUT_JSON, OUT_NUL };
+OutputFormat outputFormat = OUT_TEXT;   // 'set -o json|nul' (builtins ke records)
 
 // --- Function Declarations ---
 void loadHistory(list<string>& history);
-void saveHistory(const list<string>& history);
+void syncHistory(list<string>& history, bool force);
 void addCommandToHistory(list<string>& history, const string &command);
 string getUser();
 string getSystemName();
 string getCurrentDirectory();
-void printPrompt();
-string readInput();
-vector<string> tokenize(const string &str, const char *delim);
-void processRedirection(vector<string> &tokens, int &inputFd, int &outputFd);
-
-void handleCd(const vector<string> &tokens);
-void handlePwd(const vector<string>& tokens);
-void handleEcho(const vector<string> &tokens);
-void handleLs(const vector<string> &tokens);
-void handlePinfo(const vector<string> &tokens);
-void handleSearch(const vector<string> &tokens);
-void handleHistory(const vector<string> &tokens);
-bool searchRecursive(const char *basePath, const string &target);
-
-void executeExternalCommand(vector<string> tokens, bool background);
-void executePipedCommands(vector<string> pipedCommands);
-void executeCommand(string command);
+void printPrompt(bool continuation = false);
+string readInput(bool continuation = false);
+void paintInput(const string &input);
+
+int handleCd(const TokenList &tokens);
+int handlePwd(const TokenList &tokens);
+int handleEcho(const TokenList &tokens);
+int handleLs(const TokenList &tokens);
+int handlePinfo(const TokenList &tokens);
+int handlePinfoAll(const TokenList &tokens, OutputFormat format);
+int handleSearch(const TokenList &tokens);
+int handleHistory(const TokenList &tokens);
+int handleTest(const TokenList &tokens);
+int handleExport(const TokenList &tokens);
+int handleUnset(const TokenList &tokens);
+int handleLoopControl(const TokenList &tokens);
+int handleReturn(const TokenList &tokens);
+int handleExit(const TokenList &tokens);
+int handleSet(const TokenList &tokens);
+int handleLimit(const TokenList &tokens);
+int handleRun(const TokenList &tokens);
+void applyLaunchInChild();
+int handleTrue(const TokenList &tokens);
+int handleFalse(const TokenList &tokens);
+int handleAlias(const TokenList &tokens);
+int handleUnalias(const TokenList &tokens);
+bool searchRecursive(const char *basePath, const string &target, string *foundPath = nullptr);
+int handleContentSearch(const TokenList &tokens, OutputFormat format);
+
+// Parser / executor
+enum ParseStatus { PARSE_OK, PARSE_INCOMPLETE, PARSE_ERROR };
+Node *parseProgram(const char *src, size_t len, Arena &arena, ParseStatus &status);
+int execList(Node *list);
+int execNode(Node *n, bool execDirect);
+int execSimple(Node *n, bool execDirect);
+int execTokens(TokenList &tokens, Node *n, bool execDirect);
+int execPipeline(Node *n);
+int executeExternalCommand(TokenList &tokens, Word *assigns, Redir *redirs, bool execDirect);
+int executeCommand(const string &command);
+void expandWord(const Word *w, TokenList &out, bool split = true);
+ArenaString expandWordString(const Word *w);
+int captureCommand(Node *program, ArenaString &out);
+const char *getVar(const char *name, size_t len, char *numBuf);
+void setVar(const char *name, const char *value);
+
 void setNonCanonicalMode();
 void resetTerminal();
-string findExecutablePath(const string &cmd);
+ArenaString findExecutablePath(const char *cmd);
 
 // Arithmetic evaluator prototypes
-long long parseExpression(const string &s, size_t &i);
-long long parseTerm(const string &s, size_t &i);
-long long parseFactor(const string &s, size_t &i);
-long long evaluateArithmetic(const string &expr);
+long long parseExpression(const char *s, size_t &i);
+long long parseTerm(const char *s, size_t &i);
+long long parseFactor(const char *s, size_t &i);
+long long evaluateArithmetic(const char *expr);
 
 // --- Signal Handlers ---
 void sigintHandler(int sig);
 void sigtstpHandler(int sig);
 void sigchldHandler(int sig);
 
+// ===================== Arena Implementation =====================
+
+Arena::~Arena() {
+    while (head) {
+        Block *next = head->next;
+        ::operator delete(head);
+        head = next;
+    }
+}
+
+void *Arena::allocate(size_t n, size_t align) {
+    uintptr_t p = (reinterpret_cast<uintptr_t>(ptr) + align - 1) & ~(uintptr_t)(align - 1);
+    if (ptr == nullptr || p + n > reinterpret_cast<uintptr_t>(end)) {
+        nextBlock(n + align);
+        p = (reinterpret_cast<uintptr_t>(ptr) + align - 1) & ~(uintptr_t)(align - 1);
+    }
+    ptr = reinterpret_cast<char*>(p + n);
+    return reinterpret_cast<void*>(p);
+}
+
+char *Arena::copy(const char *s, size_t n) {
+    char *d = static_cast<char*>(allocate(n + 1, 1));
+    memcpy(d, s, n);
+    d[n] = '\0';
+    return d;
+}
+
+// Agla retained block use karo agar kaafi bada hai, warna naya block
+// current ke baad insert karo (chhote blocks list mein rehte hain).
+void Arena::nextBlock(size_t need) {
+    Block *next = cur ? cur->next : head;
+    if (next == nullptr || next->size < need) {
+        size_t size = max(blockSize, need);
+        Block *b = static_cast<Block*>(::operator new(sizeof(Block) + size));
+        b->size = size;
+        b->next = next;
+        if (cur)
+            cur->next = b;
+        else
+            head = b;
+        next = b;
+    }
+    cur = next;
+    ptr = cur->data();
+    end = ptr + cur->size;
+}
+
+// Bahut bade blocks (e.g. multi-MB $(...) capture) free karo, baaki agli line ke liye rakho
+void Arena::reset() {
+    Block **link = &head;
+    while (*link) {
+        Block *b = *link;
+        if (b->size > MAX_RETAINED_BLOCK) {
+            *link = b->next;
+            ::operator delete(b);
+        } else {
+            link = &b->next;
+        }
+    }
+    cur = nullptr;
+    ptr = end = nullptr;
+}
+
+void Arena::rewind(const Mark &m) {
+    cur = m.block;
+    ptr = m.ptr;
+    end = cur ? cur->data() + cur->size : nullptr;
+}
+
+size_t Arena::capacity() const {
+    size_t total = 0;
+    for (Block *b = head; b; b = b->next)
+        total += b->size;
+    return total;
+}
+
+// ===================== Allocation Instrumentation =====================
+
+// Global operator new hook: har allocation count hota hai taaki
+// ISHELL_ALLOC_STATS se per-command allocations dekhe ja sakein.
+// noinline: inlined free() par GCC ka -Wmismatched-new-delete false positive deta hai.
+__attribute__((noinline)) void *operator new(size_t n) {
+    allocCount.fetch_add(1, memory_order_relaxed);
+    allocBytes.fetch_add(n, memory_order_relaxed);
+    void *p = malloc(n ? n : 1);
+    if (!p)
+        throw bad_alloc();
+    return p;
+}
+
+__attribute__((noinline)) void operator delete(void *p) noexcept {
+    free(p);
+}
+
+__attribute__((noinline)) void operator delete(void *p, size_t) noexcept {
+    free(p);
+}
+
+// ===================== Clock =====================
+
+// Shell ki apni monotonic clock (line editor ka budget, pinfo -t ki rates)
+static uint64_t clockNs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
 // ===================== Signal Handlers Implementation =====================
 
 // Ctrl-C ke liye handler. Yeh foreground process ko terminate karta hai.
@@ -92,6 +451,8 @@ void sigintHandler(int sig) {
     if (fg_pid != 0) {
         kill(fg_pid, SIGINT);
         fg_pid = 0;
+    } else {
+        interruptRequested = 1;
     }
 }
 
@@ -116,7 +477,9 @@ void sigchldHandler(int sig) {
 // ===================== Terminal Settings =====================
 // Non-canonical mode mein set karta hai for char-by-char input.
 void setNonCanonicalMode() {
-    tcgetattr(STDIN_FILENO, &orig_termios);
+    if (tcgetattr(STDIN_FILENO, &orig_termios) != 0)
+        return;
+    terminalConfigured = true;
     struct termios raw = orig_termios;
     raw.c_lflag &= ~(ICANON | ECHO); 
     tcsetattr(STDIN_FILENO, TCSANOW, &raw);
@@ -124,45 +487,213 @@ void setNonCanonicalMode() {
 
 // Terminal settings ko wapas original state mein le jane ke liye.
 void resetTerminal() {
-    tcsetattr(STDIN_FILENO, TCSANOW, &orig_termios);
+    if (terminalConfigured)
+        tcsetattr(STDIN_FILENO, TCSANOW, &orig_termios);
 }
 
 // ===================== History Functions =====================
 
+// History file fixed per-user location par: $ISHELL_HISTFILE, warna $HOME/.shell_history
+static string resolveHistoryPath() {
+    const char *env = getenv("ISHELL_HISTFILE");
+    if (env && *env)
+        return env;
+    const char *home = getenv("HOME");
+    if (!home || !*home) {
+        struct passwd *pw = getpwuid(getuid());
+        home = pw ? pw->pw_dir : nullptr;
+    }
+    if (!home || !*home)
+        return HISTORY_FILE;
+    return string(home) + "/" + HISTORY_FILE;
+}
+
+static void rememberCommand(list<string>& history, const char *cmd, size_t len) {
+    if (len == 0)
+        return;
+    if (history.size() >= MAX_HISTORY_SIZE)
+        history.pop_front();
+    history.emplace_back(cmd, len);
+    historyVector.emplace_back(cmd, len);
+    if (historyVector.size() > MAX_HISTORY_SIZE)
+        historyVector.erase(historyVector.begin());
+}
+
+// historyOffset se file ke end tak sirf naye complete records padho.
+// Adhoori last line (kisi aur session ka in-flight write nahi hota, par
+// crash / short write se bacha tukda ho sakta hai) abhi nahi padhi jati.
+// Agla writer use HISTORY_FRAGMENT_END se band karta hai aur tab har reader
+// use record nahi, tukda maan kar chhod deta hai.
+// Record format: ek line per command; multi-line commands ke newline "\\n"
+// aur backslash "\\\\" ban kar store hote hain. Decode in-place hota hai;
+// unpaired aakhri '\\' wali line (valid record mein ho nahi sakti) par false.
+static bool decodeHistoryRecord(char *rec, size_t len, size_t &outLen) {
+    size_t out = 0;
+    for (size_t i = 0; i < len; i++) {
+        if (rec[i] == '\\') {
+            if (++i == len)
+                return false;
+            rec[out++] = (rec[i] == 'n') ? '\n' : rec[i];
+        } else {
+            rec[out++] = rec[i];
+        }
+    }
+    outLen = out;
+    return true;
+}
+
+static void readHistoryTail(list<string>& history) {
+    char buf[16 * 1024];
+    size_t pending = 0;         // buf mein bacha hua adhoora record
+    bool skipping = false;      // buffer se bade record ka baaki hissa
+    while (true) {
+        ssize_t n = pread(historyFd, buf + pending, sizeof(buf) - pending,
+                          historyOffset + pending);
+        if (n <= 0)
+            break;
+        size_t avail = pending + n;
+        size_t lineStart = 0;
+        for (size_t i = 0; i < avail; i++) {
+            if (buf[i] != '\n')
+                continue;
+            size_t len;
+            if (!skipping && decodeHistoryRecord(buf + lineStart, i - lineStart, len))
+                rememberCommand(history, buf + lineStart, len);
+            skipping = false;
+            lineStart = i + 1;
+        }
+        historyOffset += lineStart;
+        pending = avail - lineStart;
+        if (lineStart == 0 && pending == sizeof(buf)) {
+            // Ek record buffer se bada hai: use skip karo
+            historyOffset += pending;
+            pending = 0;
+            skipping = true;
+        } else if (pending > 0) {
+            memmove(buf, buf + lineStart, pending);
+        }
+    }
+}
+
+static void watchHistoryFile() {
+    if (historyWatchFd < 0)
+        historyWatchFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (historyWatchFd >= 0)
+        inotify_add_watch(historyWatchFd, historyPath.c_str(),
+                          IN_MODIFY | IN_MOVE_SELF | IN_DELETE_SELF);
+}
+
+static bool openHistoryFile() {
+    historyFd = open(historyPath.c_str(), O_RDWR | O_APPEND | O_CREAT | O_CLOEXEC, 0600);
+    if (historyFd < 0)
+        return false;
+    watchHistoryFile();
+    return true;
+}
+
 void loadHistory(list<string>& history) {
-    ifstream infile(HISTORY_FILE);
-    if (infile.is_open()) {
-        string line;
-        while (getline(infile, line)) {
-            if (history.size() >= MAX_HISTORY_SIZE)
-                history.pop_front();
-            history.push_back(line);
-            historyVector.push_back(line);
+    historyPath = resolveHistoryPath();
+    if (!openHistoryFile())
+        return;
+    struct stat sb;
+    if (fstat(historyFd, &sb) != 0)
+        return;
+    // Poori file nahi, sirf tail: MAX_HISTORY_SIZE records ke liye kaafi hai
+    historyOffset = 0;
+    if ((size_t)sb.st_size > HISTORY_TAIL_BYTES) {
+        historyOffset = sb.st_size - HISTORY_TAIL_BYTES;
+        char c;
+        while (pread(historyFd, &c, 1, historyOffset) == 1) {
+            historyOffset++;
+            if (c == '\n')
+                break;
         }
-        infile.close();
     }
+    readHistoryTail(history);
 }
 
-// History file ko update karta hai.
-void saveHistory(const list<string>& history) {
-    ofstream outfile(HISTORY_FILE, ios::trunc);
-    if (outfile.is_open()) {
-        for (const auto &cmd : history)
-            outfile << cmd << "\n";
-        outfile.close();
+// inotify events drain karo; kuch badla ho (ya force) to sirf appended tail padho.
+void syncHistory(list<string>& history, bool force) {
+    if (historyFd < 0)
+        return;
+    bool changed = force, replaced = false;
+    if (historyWatchFd >= 0) {
+        char evbuf[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+        ssize_t n;
+        while ((n = read(historyWatchFd, evbuf, sizeof(evbuf))) > 0) {
+            for (char *p = evbuf; p < evbuf + n; ) {
+                struct inotify_event *ev = reinterpret_cast<struct inotify_event*>(p);
+                if (ev->mask & (IN_MOVE_SELF | IN_DELETE_SELF | IN_IGNORED))
+                    replaced = true;
+                changed = true;
+                p += sizeof(struct inotify_event) + ev->len;
+            }
+        }
     }
+    if (replaced) {
+        // File rotate/delete hui: nayi file kholo aur shuru se padho
+        close(historyFd);
+        historyOffset = 0;
+        if (!openHistoryFile())
+            return;
+    }
+    if (!changed)
+        return;
+    struct stat sb;
+    if (fstat(historyFd, &sb) == 0 && sb.st_size < historyOffset)
+        historyOffset = 0;      // truncate ho gayi
+    readHistoryTail(history);
 }
 
+// File '\n' par khatam na ho to pichhla record adhoora hai: apne record se pehle
+// HISTORY_FRAGMENT_END likho taaki tukda alag line bane aur unpaired '\\' par
+// khatam ho (tukde ke aakhir mein '\\' ho tab bhi beech ka char use kha leta hai).
+// Do sessions ek saath repair karein to doosra marker akela line banta hai,
+// woh bhi chhoot jata hai.
+static const char HISTORY_FRAGMENT_END[] = " \\\n";
+
+static bool historyEndsInFragment() {
+    struct stat sb;
+    char last;
+    return fstat(historyFd, &sb) == 0 && sb.st_size > 0 &&
+           pread(historyFd, &last, 1, sb.st_size - 1) == 1 && last != '\n';
+}
+
+// Har command ek single O_APPEND write() hai, isliye kai sessions ke
+// records interleave ho sakte hain par kabhi aapas mein mix nahi hote.
 void addCommandToHistory(list<string>& history, const string &command) {
     if (command.empty())
         return;
-    if (history.size() >= MAX_HISTORY_SIZE)
-        history.pop_front();
-    history.push_back(command);
-    historyVector.push_back(command);
-    if (historyVector.size() > MAX_HISTORY_SIZE)
-        historyVector.erase(historyVector.begin());
-    saveHistory(history);
+    if (historyFd < 0) {
+        rememberCommand(history, command.c_str(), command.size());
+        return;
+    }
+    size_t markerLen = sizeof(HISTORY_FRAGMENT_END) - 1;
+    char *record = static_cast<char*>(currentArena->allocate(markerLen + command.size() * 2 + 1, 1));
+    size_t len = 0;
+    if (historyEndsInFragment()) {
+        memcpy(record, HISTORY_FRAGMENT_END, markerLen);
+        len = markerLen;
+    }
+    for (size_t i = 0; i < command.size(); i++) {
+        if (command[i] == '\n' || command[i] == '\\') {
+            record[len++] = '\\';
+            record[len++] = (command[i] == '\n') ? 'n' : '\\';
+        } else {
+            record[len++] = command[i];
+        }
+    }
+    record[len++] = '\n';
+    ssize_t n;
+    do {
+        n = write(historyFd, record, len);
+    } while (n < 0 && errno == EINTR);
+    if (n != (ssize_t)len) {
+        rememberCommand(history, command.c_str(), command.size());
+        return;
+    }
+    // Apna record (aur beech mein aaye dusre sessions ke) file order mein uthao
+    syncHistory(history, true);
 }
 
 // ===================== Prompt and Input Functions =====================
@@ -187,789 +718,5301 @@ string getCurrentDirectory() {
     return "";
 }
 
-void printPrompt() {
+// continuation: adhoore command (khula 'do'/'fi'/quote) ki agli line ke liye "> "
+void printPrompt(bool continuation) {
+    if (continuation) {
+        if (promptMarks)
+            cout << PROMPT_MARK_START;
+        cout << COLOR_YELLOW << "> " << COLOR_CYAN;
+        if (promptMarks)
+            cout << PROMPT_MARK_END;
+        cout.flush();
+        return;
+    }
     string user = getUser();
     string sys = getSystemName();
     string cwd = getCurrentDirectory();
     const char *home = getenv("HOME");
     if (home && cwd.find(home) == 0)
         cwd = "~" + cwd.substr(strlen(home));
+    if (promptMarks)
+        cout << PROMPT_MARK_START;
     cout << COLOR_BLUE << user << COLOR_RED << "@" << COLOR_GREEN << sys
         << COLOR_RESET << ":" << COLOR_PURPLE << cwd << COLOR_YELLOW << "> " 
         << COLOR_CYAN;
+    if (promptMarks)
+        cout << PROMPT_MARK_END;
     cout.flush();
 }
 
-// ===================== readInput() with Autocomplete & History =====================
+// ===================== Builtin Registry =====================
 
-// Function arrow keys, TAB, Ctrl-D handle karta hai.
-string readInput() {
-    string input;
-    size_t historyIndex = historyVector.size(); 
-    printPrompt();
-    int c;
-    while ((c = getchar()) != EOF) {
-        if (c == '\n') {
-            cout << COLOR_RESET << "\n";
-            break;
-        }
-        if (c == 27) {                      // Arrow keys ke liye escape seq
-            int seq1 = getchar();
-            int seq2 = getchar();
-            if (seq1 == '[') {
-                if (seq2 == 'A') {          // UP arrow 
-                    if (!historyVector.empty() && historyIndex > 0) {
-                        historyIndex--;
-                        input = historyVector[historyIndex];
-                        cout << "\r\033[K"; // line clear karo
-                        printPrompt();
-                        cout << input;
-                    }
-                } else if (seq2 == 'B') {   // DOWN arrow 
-                    if (!historyVector.empty() && historyIndex < historyVector.size() - 1) {
-                        historyIndex++;
-                        input = historyVector[historyIndex];
-                        cout << "\r\033[K";
-                        printPrompt();
-                        cout << input;
-                    } else {
-                        // Sabse recent history pe pohonch gaye, to input clear karo
-                        historyIndex = historyVector.size();
-                        input = "";
-                        cout << "\r\033[K";
-                        printPrompt();
-                    }
-                }
-            }
-            continue;
-        } else if (c == '\t') {
-            size_t pos = input.find_last_of(" ");
-            string currentToken = (pos == string::npos) ? input : input.substr(pos + 1);
-            string dirPath, filePrefix;
-            size_t slashPos = currentToken.rfind('/');
-            if (slashPos != string::npos) {
-                // Agar directory part mil jaye
-                dirPath = currentToken.substr(0, slashPos + 1);
-                filePrefix = currentToken.substr(slashPos + 1);
-            } else {
-                // Nahi to current directory ka use karo
-                dirPath = ".";
-                filePrefix = currentToken;
-            }
-            vector<string> matches;
-            DIR *dp = opendir(dirPath.c_str());
-            if (dp) {
-                struct dirent *entry;
-                while ((entry = readdir(dp)) != nullptr) {
-                    string fname(entry->d_name);
-                    if (fname.find(filePrefix) == 0)
-                        matches.push_back(fname);
-                }
-                closedir(dp);
-            }
-            if (matches.size() == 1) {
-                string completion = matches[0].substr(filePrefix.size());
-                input += completion;
-                cout << completion;
-            } else if (matches.size() > 1) {
-                sort(matches.begin(), matches.end());
-                cout << "\n";
-                for (const auto &m : matches)
-                    cout << m << "    ";
-                cout << "\n";
-                printPrompt();
-                cout << input;
-            }
-            continue;
-        } else if (c == 127 || c == 8) {    // Backspace key
-            if (!input.empty()) {
-                input.pop_back();
-                cout << "\b \b";
-            }
-            continue;
-        } else if (c == 4) {                // Ctrl-D: exit if no input
-            if (input.empty()) {
-                cout << "\n";
-                exit(0);
-            }
-            break;
-        } else {
-            input.push_back((char)c);
-            cout << (char)c;
-        }
-    }
-    return input;
+// Har builtin ka descriptor compile time par ek perfect-hash table mein:
+// lookup = ek hash, ek slot, ek strcmp (pehle yeh if-else ki chain thi).
+// Naya builtin bas builtinTable mein jodo; seed aur slots constexpr se bante
+// hain aur static_assert collision-free hone ki guarantee deta hai.
+
+typedef int (*BuiltinHandler)(const TokenList &);
+
+enum BuiltinFlags : unsigned {
+    BI_REDIRECT = 1,        // redirections (RedirectionGuard) ke saath chal sakta hai
+    BI_PIPELINE = 2         // pipeline / $(...) stage bina fork: sirf cout, koi shell state nahi, tty se bekhabar
+};
+
+struct BuiltinDesc {
+    const char *name;
+    BuiltinHandler handler;
+    unsigned flags;
+};
+
+constexpr BuiltinDesc builtinTable[] = {
+    {"cd", handleCd, BI_REDIRECT},
+    {"pwd", handlePwd, BI_REDIRECT | BI_PIPELINE},
+    {"echo", handleEcho, BI_REDIRECT | BI_PIPELINE},
+    {"ls", handleLs, BI_REDIRECT},              // tty par rang / columns
+    {"pinfo", handlePinfo, BI_REDIRECT},
+    {"search", handleSearch, BI_REDIRECT},
+    {"history", handleHistory, BI_REDIRECT | BI_PIPELINE},
+    {"exit", handleExit, 0},                    // control flow (break/continue/return bhi): redirect karne ko kuch nahi
+    {"true", handleTrue, BI_REDIRECT | BI_PIPELINE},
+    {":", handleTrue, BI_REDIRECT | BI_PIPELINE},
+    {"false", handleFalse, BI_REDIRECT | BI_PIPELINE},
+    {"test", handleTest, BI_REDIRECT | BI_PIPELINE},
+    {"[", handleTest, BI_REDIRECT | BI_PIPELINE},
+    {"export", handleExport, BI_REDIRECT},
+    {"unset", handleUnset, BI_REDIRECT},
+    {"break", handleLoopControl, 0},
+    {"continue", handleLoopControl, 0},
+    {"return", handleReturn, 0},
+    {"set", handleSet, BI_REDIRECT},
+    {"limit", handleLimit, BI_REDIRECT},        // child fd 1 par seedha likhta hai
+    {"run", handleRun, BI_REDIRECT},
+    {"alias", handleAlias, BI_REDIRECT},
+    {"unalias", handleUnalias, BI_REDIRECT},
+};
+
+constexpr size_t BUILTIN_COUNT = sizeof(builtinTable) / sizeof(builtinTable[0]);
+constexpr unsigned BUILTIN_SLOT_BITS = 6;
+constexpr unsigned BUILTIN_SLOTS = 1u << BUILTIN_SLOT_BITS;
+static_assert(BUILTIN_COUNT < BUILTIN_SLOTS, "builtin table bhar gaya: BUILTIN_SLOT_BITS badhao");
+
+// FNV-1a; slot upar ke bits se (neeche ke bits sirf chars ke neeche ke bits par nirbhar)
+constexpr uint32_t builtinHash(const char *s, uint32_t h) {
+    return *s ? builtinHash(s + 1, (h ^ (unsigned char)*s) * 16777619u) : h;
 }
 
-// ===================== Tokenization Helper =====================
+constexpr unsigned builtinSlot(const char *s, uint32_t seed) {
+    return builtinHash(s, seed) >> (32 - BUILTIN_SLOT_BITS);
+}
 
-// Tokenize string based on delimiter
-vector<string> tokenize(const string &str, const char *delim) {
-    vector<string> tokens;
-    char *cstr = new char[str.size() + 1];
-    strcpy(cstr, str.c_str());
-    char *saveptr;
-    char *token = strtok_r(cstr, delim, &saveptr);
-    while (token != nullptr) {
-        string t(token);
-        // token quotes mein hai, to unhe hata do
-        if (t.size() >= 2 && ((t.front() == '"' && t.back() == '"') ||
-            (t.front() == '\'' && t.back() == '\'')))
-            t = t.substr(1, t.size() - 2);
-        tokens.push_back(t);
-        token = strtok_r(nullptr, delim, &saveptr);
-    }
-    delete[] cstr;
-    return tokens;
+constexpr bool slotFree(uint32_t seed, size_t i, size_t j) {
+    return j >= i ? true :
+           builtinSlot(builtinTable[i].name, seed) == builtinSlot(builtinTable[j].name, seed) ? false :
+           slotFree(seed, i, j + 1);
 }
 
-// ===================== findExecutablePath Helper =====================
+constexpr bool collisionFree(uint32_t seed, size_t i) {
+    return i >= BUILTIN_COUNT ? true : slotFree(seed, i, 0) && collisionFree(seed, i + 1);
+}
 
-string findExecutablePath(const string &cmd) {
-    string trimmed = cmd;
-    size_t start = trimmed.find_first_not_of(" \t");
-    size_t end = trimmed.find_last_not_of(" \t");
-    if (start != string::npos && end != string::npos)
-        trimmed = trimmed.substr(start, end - start + 1);
-    else
-        trimmed = "";
-    if (trimmed.empty())
-        return "";
-    if (trimmed.find('/') != string::npos)
-        return trimmed;
-    vector<string> commonDirs = {"/bin", "/usr/bin", "/usr/local/bin"};
-    for (const auto &dir : commonDirs) {
-        string fullPath = dir + "/" + trimmed;
-        if (access(fullPath.c_str(), X_OK) == 0) {
-            if (fullPath.find("Xorg.wrap") != string::npos)
-                continue;
-            return fullPath;
-        }
+// FNV offset basis se shuru karke pehla collision-free seed
+constexpr uint32_t findBuiltinSeed(uint32_t seed, unsigned tries) {
+    return collisionFree(seed, 0) ? seed : tries == 0 ? 0 : findBuiltinSeed(seed + 1, tries - 1);
+}
+
+constexpr uint32_t BUILTIN_SEED = findBuiltinSeed(2166136261u, 400);
+static_assert(collisionFree(BUILTIN_SEED, 0), "builtin perfect hash nahi mila: BUILTIN_SLOT_BITS badhao");
+
+constexpr int8_t slotEntry(unsigned slot, size_t i) {
+    return i >= BUILTIN_COUNT ? -1 :
+           builtinSlot(builtinTable[i].name, BUILTIN_SEED) == slot ? (int8_t)i : slotEntry(slot, i + 1);
+}
+
+// 0..BUILTIN_SLOTS-1 ka pack, taaki slot table ek initializer mein bane (C++11)
+template <unsigned... S> struct SlotList {};
+template <unsigned N, unsigned... S> struct MakeSlots : MakeSlots<N - 1, N - 1, S...> {};
+template <unsigned... S> struct MakeSlots<0, S...> { typedef SlotList<S...> type; };
+
+template <class L> struct BuiltinSlots;
+template <unsigned... S> struct BuiltinSlots<SlotList<S...>> {
+    static constexpr int8_t table[sizeof...(S)] = {slotEntry(S, 0)...};
+};
+template <unsigned... S> constexpr int8_t BuiltinSlots<SlotList<S...>>::table[sizeof...(S)];
+
+typedef BuiltinSlots<MakeSlots<BUILTIN_SLOTS>::type> builtinSlots;
+
+const BuiltinDesc *findBuiltin(const char *name) {
+    int i = builtinSlots::table[builtinSlot(name, BUILTIN_SEED)];
+    if (i < 0 || strcmp(builtinTable[i].name, name) != 0)
+        return nullptr;
+    return &builtinTable[i];
+}
+
+
+// ===================== Fuzzy Completion =====================
+
+// Candidate kinds (menu mein tag ke saath dikhte hain)
+enum CandidateKind { CAND_BUILTIN, CAND_ALIAS, CAND_FUNCTION, CAND_COMMAND, CAND_DIR, CAND_FILE, CAND_HISTORY };
+static const char *const candidateTags[] = {"builtin", "alias", "function", "command", "dir", "file", "history"};
+
+const size_t SCORE_WINDOW = 64;     // SIMD kernel ek candidate ke itne bytes ek saath dekhta hai
+const int SCORE_MATCH = 16;         // har matched char
+const int BONUS_CONSECUTIVE = 16;   // pichle match ke turant baad
+const int BONUS_BOUNDARY = 10;      // word ki shuruaat ('/', '-', '_', '.', ' ' ke baad)
+const int BONUS_PREFIX = 20;        // candidate ka pehla char
+const int MAX_GAP_PENALTY = 8;      // do matches ke beech skip kiye chars (capped)
+const size_t MENU_PAGE_SIZE = 10;
+
+static inline unsigned char foldChar(unsigned char c) {
+    return (c >= 'A' && c <= 'Z') ? (unsigned char)(c | 0x20) : c;
+}
+
+static inline bool isWordSeparator(unsigned char c) {
+    return c == '/' || c == '-' || c == '_' || c == '.' || c == ' ';
+}
+
+// Case-folded char ka bit; pattern ka set candidate ke set ka subset na ho to score hi mat karo
+static inline uint64_t charBit(unsigned char c) {
+    c = foldChar(c);
+    if (c >= 'a' && c <= 'z')
+        return 1ULL << (c - 'a');
+    if (c >= '0' && c <= '9')
+        return 1ULL << (26 + c - '0');
+    return 1ULL << (36 + c % 28);
+}
+
+static uint64_t charMaskOf(const char *s, size_t len) {
+    uint64_t mask = 0;
+    for (size_t i = 0; i < len; i++)
+        mask |= charBit((unsigned char)s[i]);
+    return mask;
+}
+
+// Saare candidates ek hi blob mein; SIMD kernel har candidate ki 64-byte window
+// seedha load karta hai, isliye blob ke end par padding rakhi jati hai.
+class CandidateSet {
+public:
+    struct Item {
+        uint32_t offset;
+        uint32_t len;
+        uint64_t charMask;
+        int kind;
+    };
+
+    void clear() { blob.clear(); items.clear(); }
+    void add(const char *s, size_t len, int kind) {
+        Item it;
+        it.offset = (uint32_t)blob.size();
+        it.len = (uint32_t)len;
+        it.charMask = charMaskOf(s, len);
+        it.kind = kind;
+        blob.append(s, len);
+        items.push_back(it);
     }
-    char *pathEnv = getenv("PATH");
-    if (pathEnv) {
-        string pathStr(pathEnv);
-        vector<string> paths = tokenize(pathStr, ":");
-        for (const auto &dir : paths) {
-            string fullPath = dir + "/" + trimmed;
-            if (access(fullPath.c_str(), X_OK) == 0) {
-                if (fullPath.find("Xorg.wrap") != string::npos)
-                    continue;
-                return fullPath;
-            }
-        }
+    void seal() { blob.append(SCORE_WINDOW, '\0'); }
+    size_t size() const { return items.size(); }
+    const Item &item(size_t i) const { return items[i]; }
+    const char *text(size_t i) const { return blob.data() + items[i].offset; }
+
+private:
+    string blob;
+    vector<Item> items;
+};
+
+// Ek matched position ka score; scalar aur SIMD dono isi formula se chalte hain
+static inline int matchScore(int pos, int prev, bool boundary) {
+    int s = SCORE_MATCH;
+    if (pos == 0)
+        s += BONUS_PREFIX;
+    if (boundary)
+        s += BONUS_BOUNDARY;
+    if (prev >= 0) {
+        int gap = pos - prev - 1;
+        if (gap == 0)
+            s += BONUS_CONSECUTIVE;
+        else
+            s -= min(gap, MAX_GAP_PENALTY);
     }
-    return "";
+    return s;
 }
 
-// ===================== I/O Redirection Helper =====================
-
-// I/O redirection operators (<, >, >>) ko process karta hai
-void processRedirection(vector<string> &tokens, int &inputFd, int &outputFd) {
-    inputFd = -1;
-    outputFd = -1;
-    vector<string> newTokens;
-    for (size_t i = 0; i < tokens.size(); i++) {
-        if (tokens[i] == "<") {
-            if (i + 1 < tokens.size()) {
-                inputFd = open(tokens[i + 1].c_str(), O_RDONLY);
-                if (inputFd < 0)
-                    perror("open input");
-                i++;
-            } else {
-                cerr << "No input file specified\n";
-            }
-        } else if (tokens[i] == ">") {
-            if (i + 1 < tokens.size()) {
-                outputFd = open(tokens[i + 1].c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
-                if (outputFd < 0)
-                    perror("open output");
-                i++;
-            } else {
-                cerr << "No output file specified\n";
-            }
-        } else if (tokens[i] == ">>") {
-            if (i + 1 < tokens.size()) {
-                outputFd = open(tokens[i + 1].c_str(), O_WRONLY | O_CREAT | O_APPEND, 0644);
-                if (outputFd < 0)
-                    perror("open output");
-                i++;
-            } else {
-                cerr << "No output file specified\n";
-            }
-        } else {
-            newTokens.push_back(tokens[i]);
-        }
+// Greedy leftmost subsequence match; pat pehle se folded hai
+static bool fuzzyScoreScalar(const char *pat, size_t patLen, const char *s, size_t len, int &score) {
+    int total = 0, prev = -1;
+    size_t i = 0;
+    for (size_t k = 0; k < patLen; k++, i++) {
+        while (i < len && foldChar((unsigned char)s[i]) != (unsigned char)pat[k])
+            i++;
+        if (i >= len)
+            return false;
+        bool boundary = (i == 0) || isWordSeparator((unsigned char)s[i - 1]);
+        total += matchScore((int)i, prev, boundary);
+        prev = (int)i;
     }
-    tokens = newTokens;
+    score = total - (int)(len >> 3);
+    return true;
 }
 
-// ===================== Arithmetic Evaluator =====================
+// Per-char position bitmasks se wahi greedy match (prev ke baad ka pehla set bit)
+static bool scoreFromMasks(const uint64_t *masks, size_t patLen, uint64_t sepMask,
+                           size_t len, int &score) {
+    uint64_t boundary = (sepMask << 1) | 1;
+    int total = 0, prev = -1;
+    for (size_t k = 0; k < patLen; k++) {
+        uint64_t m = masks[k];
+        if (prev >= 0)
+            m = (prev >= 63) ? 0 : (m & (~0ULL << (prev + 1)));
+        if (m == 0)
+            return false;
+        int pos = __builtin_ctzll(m);
+        total += matchScore(pos, prev, (boundary >> pos) & 1);
+        prev = pos;
+    }
+    score = total - (int)(len >> 3);
+    return true;
+}
 
-// recursive-descent parser arithmetic expressions evaluate karta hai
-long long parseExpression(const string &s, size_t &i) {
-    long long result = parseTerm(s, i);
-    while (i < s.size()) {
-        if (s[i] == '+') {
-            i++;
-            result += parseTerm(s, i);
-        } else if (s[i] == '-') {
-            i++;
-            result -= parseTerm(s, i);
-        } else {
-            break;
-        }
+#if ISHELL_X86_SIMD
+// SSE2 (x86-64 baseline): 4 x 16 bytes compare -> 64-bit position mask
+static bool fuzzyScoreSse2(const char *pat, size_t patLen, const char *s, size_t len, int &score) {
+    const __m128i caseBit = _mm_set1_epi8(0x20);
+    __m128i raw[4], folded[4];
+    for (int j = 0; j < 4; j++) {
+        raw[j] = _mm_loadu_si128((const __m128i *)(s + 16 * j));
+        folded[j] = _mm_or_si128(raw[j], caseBit);
     }
-    return result;
+    uint64_t lenMask = (len >= 64) ? ~0ULL : ((1ULL << len) - 1);
+    uint64_t masks[SCORE_WINDOW];
+    for (size_t k = 0; k < patLen; k++) {
+        unsigned char pc = (unsigned char)pat[k];
+        // Letters ke liye (c | 0x20) compare sirf A-Z/a-z ko match karta hai; baaki exact
+        const __m128i *hay = (pc >= 'a' && pc <= 'z') ? folded : raw;
+        __m128i needle = _mm_set1_epi8((char)pc);
+        uint64_t m = 0;
+        for (int j = 0; j < 4; j++)
+            m |= (uint64_t)(uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(hay[j], needle)) << (16 * j);
+        masks[k] = m & lenMask;
+        if (masks[k] == 0)
+            return false;
+    }
+    uint64_t sep = 0;
+    static const char seps[] = {'/', '-', '_', '.', ' '};
+    for (int j = 0; j < 4; j++) {
+        __m128i acc = _mm_setzero_si128();
+        for (char c : seps)
+            acc = _mm_or_si128(acc, _mm_cmpeq_epi8(raw[j], _mm_set1_epi8(c)));
+        sep |= (uint64_t)(uint32_t)_mm_movemask_epi8(acc) << (16 * j);
+    }
+    return scoreFromMasks(masks, patLen, sep & lenMask, len, score);
 }
 
-long long parseTerm(const string &s, size_t &i) {
-    long long result = parseFactor(s, i);
-    while (i < s.size()) {
-        if (s[i] == '*') {
-            i++;
-            result *= parseFactor(s, i);
-        } else if (s[i] == '/') {
-            i++;
-            long long divisor = parseFactor(s, i);
-            if (divisor == 0) {
-                cerr << "Division by zero in arithmetic expression\n";
-                exit(EXIT_FAILURE);
-            }
-            result /= divisor;
-        } else {
-            break;
-        }
+// AVX2: 2 x 32 bytes, baaki SSE2 jaisa hi
+__attribute__((target("avx2")))
+static bool fuzzyScoreAvx2(const char *pat, size_t patLen, const char *s, size_t len, int &score) {
+    const __m256i caseBit = _mm256_set1_epi8(0x20);
+    __m256i raw[2], folded[2];
+    for (int j = 0; j < 2; j++) {
+        raw[j] = _mm256_loadu_si256((const __m256i *)(s + 32 * j));
+        folded[j] = _mm256_or_si256(raw[j], caseBit);
     }
-    return result;
+    uint64_t lenMask = (len >= 64) ? ~0ULL : ((1ULL << len) - 1);
+    uint64_t masks[SCORE_WINDOW];
+    for (size_t k = 0; k < patLen; k++) {
+        unsigned char pc = (unsigned char)pat[k];
+        const __m256i *hay = (pc >= 'a' && pc <= 'z') ? folded : raw;
+        __m256i needle = _mm256_set1_epi8((char)pc);
+        uint64_t lo = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(hay[0], needle));
+        uint64_t hi = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(hay[1], needle));
+        masks[k] = (lo | (hi << 32)) & lenMask;
+        if (masks[k] == 0)
+            return false;
+    }
+    uint64_t sep = 0;
+    static const char seps[] = {'/', '-', '_', '.', ' '};
+    for (int j = 0; j < 2; j++) {
+        __m256i acc = _mm256_setzero_si256();
+        for (char c : seps)
+            acc = _mm256_or_si256(acc, _mm256_cmpeq_epi8(raw[j], _mm256_set1_epi8(c)));
+        sep |= (uint64_t)(uint32_t)_mm256_movemask_epi8(acc) << (32 * j);
+    }
+    return scoreFromMasks(masks, patLen, sep & lenMask, len, score);
 }
+#endif
 
-long long parseFactor(const string &s, size_t &i) {
-    while (i < s.size() && isspace(s[i]))
-        i++;
+typedef bool (*ScoreKernel)(const char *, size_t, const char *, size_t, int &);
+
+// CPU dekh ke kernel ek baar chuno
+static ScoreKernel pickScoreKernel() {
+#if ISHELL_X86_SIMD
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+        return fuzzyScoreAvx2;
+    return fuzzyScoreSse2;
+#else
+    return fuzzyScoreScalar;
+#endif
+}
+
+// s ke baad kam se kam SCORE_WINDOW readable bytes hone chahiye (CandidateSet::seal)
+static bool fuzzyScore(const char *pat, size_t patLen, const char *s, size_t len, int &score) {
+    static const ScoreKernel kernel = pickScoreKernel();
+    if (len > SCORE_WINDOW || patLen > SCORE_WINDOW)
+        return fuzzyScoreScalar(pat, patLen, s, len, score);
+    return kernel(pat, patLen, s, len, score);
+}
+
+// PATH ke executables ka cache; PATH ya kisi dir ka mtime badle tabhi dobara padha jata hai
+class ExecutableIndex {
+public:
+    const vector<string> &names() {
+        refresh();
+        return commands;
+    }
+    // Highlighter ke liye: refresh ke bina sorted list mein binary search
+    bool contains(const char *name, size_t len) const {
+        auto it = lower_bound(commands.begin(), commands.end(), len ? name : "",
+            [len](const string &s, const char *n) {
+                int cmp = memcmp(s.data(), n, min(s.size(), len));
+                return cmp < 0 || (cmp == 0 && s.size() < len);
+            });
+        return it != commands.end() && it->size() == len && memcmp(it->data(), name, len) == 0;
+    }
+    bool ready() const { return built; }
+    void update() { refresh(); }
+
+private:
+    struct Dir {
+        string path;
+        struct timespec mtime;
+    };
+    string pathValue;
+    vector<Dir> dirs;
+    vector<string> commands;
+    bool built = false;
+
+    bool upToDate(const char *pathEnv) {
+        if (!built || pathValue != pathEnv)
+            return false;
+        struct stat st;
+        for (const Dir &d : dirs) {
+            if (stat(d.path.c_str(), &st) != 0) {
+                // Scan ke waqt bhi nahi tha (mtime 0) to kuch nahi badla
+                if (d.mtime.tv_sec == 0 && d.mtime.tv_nsec == 0)
+                    continue;
+                return false;
+            }
+            if (st.st_mtim.tv_sec != d.mtime.tv_sec || st.st_mtim.tv_nsec != d.mtime.tv_nsec)
+                return false;
+        }
+        return true;
+    }
+
+    void scanDir(Dir &d) {
+        DIR *dp = opendir(d.path.c_str());
+        if (!dp)
+            return;
+        struct stat st;
+        if (fstat(dirfd(dp), &st) == 0)
+            d.mtime = st.st_mtim;
+        struct dirent *entry;
+        while ((entry = readdir(dp)) != nullptr) {
+            if (entry->d_name[0] == '.' || entry->d_type == DT_DIR)
+                continue;
+            if (fstatat(dirfd(dp), entry->d_name, &st, 0) != 0)
+                continue;
+            if (S_ISREG(st.st_mode) && (st.st_mode & 0111))
+                commands.push_back(entry->d_name);
+        }
+        closedir(dp);
+    }
+
+    void refresh() {
+        const char *pathEnv = getenv("PATH");
+        if (!pathEnv)
+            pathEnv = "";
+        if (upToDate(pathEnv))
+            return;
+        built = true;
+        pathValue = pathEnv;
+        dirs.clear();
+        commands.clear();
+        // findExecutablePath() wala hi order: common dirs, phir PATH
+        vector<string> paths = {"/bin", "/usr/bin", "/usr/local/bin"};
+        for (const char *p = pathEnv; *p; ) {
+            const char *colon = strchr(p, ':');
+            size_t len = colon ? (size_t)(colon - p) : strlen(p);
+            if (len > 0)
+                paths.emplace_back(p, len);
+            p = colon ? colon + 1 : p + len;
+        }
+        for (const string &p : paths) {
+            bool seen = false;
+            for (const Dir &d : dirs)
+                seen = seen || d.path == p;
+            if (seen)
+                continue;
+            Dir d;
+            d.path = p;
+            d.mtime.tv_sec = 0;
+            d.mtime.tv_nsec = 0;
+            scanDir(d);
+            dirs.push_back(d);
+        }
+        sort(commands.begin(), commands.end());
+        commands.erase(unique(commands.begin(), commands.end()), commands.end());
+    }
+};
+
+ExecutableIndex executableIndex;
+
+// Token command ki jagah par hai? (line ki shuruaat, ya | ; & ( { ya keyword ke baad)
+static bool isCommandPosition(const string &input, size_t tokenStart) {
+    size_t end = tokenStart;
+    while (end > 0 && input[end - 1] == ' ')
+        end--;
+    if (end == 0)
+        return true;
+    char last = input[end - 1];
+    if (strchr("|;&({", last))
+        return true;
+    size_t start = input.find_last_of(" |;&({", end - 1);
+    start = (start == string::npos) ? 0 : start + 1;
+    string word = input.substr(start, end - start);
+    static const char *const keywords[] = {"then", "do", "else", "elif", "if", "while", "until", "!"};
+    for (const char *kw : keywords) {
+        if (word == kw)
+            return true;
+    }
+    return false;
+}
+
+static void addFileCandidates(CandidateSet &set, const string &dirPath, bool showHidden) {
+    DIR *dp = opendir(dirPath.empty() ? "." : dirPath.c_str());
+    if (!dp)
+        return;
+    struct dirent *entry;
+    while ((entry = readdir(dp)) != nullptr) {
+        const char *name = entry->d_name;
+        if (strcmp(name, ".") == 0 || strcmp(name, "..") == 0)
+            continue;
+        if (name[0] == '.' && !showHidden)
+            continue;
+        bool isDir = entry->d_type == DT_DIR;
+        if (entry->d_type == DT_LNK || entry->d_type == DT_UNKNOWN) {
+            struct stat st;
+            isDir = fstatat(dirfd(dp), name, &st, 0) == 0 && S_ISDIR(st.st_mode);
+        }
+        set.add(name, strlen(name), isDir ? CAND_DIR : CAND_FILE);
+    }
+    closedir(dp);
+}
+
+struct CompletionMatch {
+    int score;
+    uint32_t index;
+};
+
+// Candidates + ranked matches; har TAB par memory reuse hoti hai
+struct Completion {
+    CandidateSet candidates;
+    vector<CompletionMatch> matches;
+    string head;        // token se pehle ka input (+ dir part)
+    string original;    // TAB se pehle ka input
+};
+
+static void collectCompletions(Completion &comp, const string &input) {
+    CandidateSet &set = comp.candidates;
+    set.clear();
+    comp.matches.clear();
+    comp.original = input;
+
+    size_t space = input.find_last_of(' ');
+    size_t tokenStart = (space == string::npos) ? 0 : space + 1;
+    string token = input.substr(tokenStart);
+    size_t slash = token.rfind('/');
+    string pattern = (slash == string::npos) ? token : token.substr(slash + 1);
+    comp.head = input.substr(0, tokenStart) + (slash == string::npos ? "" : token.substr(0, slash + 1));
+
+    if (slash == string::npos && isCommandPosition(input, tokenStart)) {
+        for (const BuiltinDesc &b : builtinTable)
+            set.add(b.name, strlen(b.name), CAND_BUILTIN);
+        for (const auto &a : aliases)
+            set.add(a.first.data(), a.first.size(), CAND_ALIAS);
+        for (const auto &f : functions)
+            set.add(f.first.data(), f.first.size(), CAND_FUNCTION);
+        for (const string &cmd : executableIndex.names())
+            set.add(cmd.data(), cmd.size(), CAND_COMMAND);
+        // Pura line ek hi word ho to history lines bhi (poora input replace hota hai)
+        if (tokenStart == 0) {
+            for (size_t i = historyVector.size(); i-- > 0; )
+                set.add(historyVector[i].data(), historyVector[i].size(), CAND_HISTORY);
+        }
+    } else {
+        addFileCandidates(set, slash == string::npos ? "" : token.substr(0, slash + 1),
+                          !pattern.empty() && pattern[0] == '.');
+    }
+    set.seal();
+
+    string folded(pattern);
+    for (char &c : folded)
+        c = (char)foldChar((unsigned char)c);
+    uint64_t patMask = charMaskOf(folded.data(), folded.size());
+    for (size_t i = 0; i < set.size(); i++) {
+        const CandidateSet::Item &it = set.item(i);
+        if ((it.charMask & patMask) != patMask)
+            continue;
+        int score;
+        if (fuzzyScore(folded.data(), folded.size(), set.text(i), it.len, score)) {
+            CompletionMatch m;
+            m.score = score;
+            m.index = (uint32_t)i;
+            comp.matches.push_back(m);
+        }
+    }
+    // Score, phir chhota naam, phir alphabetical; same naam (builtin vs /bin) ek hi baar
+    sort(comp.matches.begin(), comp.matches.end(),
+         [&set](const CompletionMatch &a, const CompletionMatch &b) {
+             if (a.score != b.score)
+                 return a.score > b.score;
+             const CandidateSet::Item &x = set.item(a.index), &y = set.item(b.index);
+             if (x.len != y.len)
+                 return x.len < y.len;
+             int cmp = memcmp(set.text(a.index), set.text(b.index), x.len);
+             if (cmp != 0)
+                 return cmp < 0;
+             return x.kind < y.kind;
+         });
+    comp.matches.erase(unique(comp.matches.begin(), comp.matches.end(),
+                              [&set](const CompletionMatch &a, const CompletionMatch &b) {
+                                  const CandidateSet::Item &x = set.item(a.index), &y = set.item(b.index);
+                                  return x.len == y.len &&
+                                         memcmp(set.text(a.index), set.text(b.index), x.len) == 0;
+                              }),
+                       comp.matches.end());
+}
+
+// Match i lagane ke baad poora input
+static string applyCompletion(const Completion &comp, size_t i) {
+    uint32_t idx = comp.matches[i].index;
+    const CandidateSet::Item &it = comp.candidates.item(idx);
+    string text(comp.candidates.text(idx), it.len);
+    if (it.kind == CAND_HISTORY)
+        return text;
+    return comp.head + text + (it.kind == CAND_DIR ? "/" : "");
+}
+
+static void redrawLine(const string &input, bool continuation) {
+    cout << "\r\033[K";
+    printPrompt(continuation);
+    paintInput(input);
+    cout.flush();
+}
+
+// Input line ke neeche current page; cursor wapas input ke end par
+static void drawMenu(const Completion &comp, size_t selected, const string &input, bool continuation) {
+    struct winsize ws;
+    size_t cols = 80;
+    if (ioctl(STDOUT_FILENO, TIOCGWINSZ, &ws) == 0 && ws.ws_col > 20)
+        cols = ws.ws_col;
+    size_t total = comp.matches.size();
+    size_t first = selected / MENU_PAGE_SIZE * MENU_PAGE_SIZE;
+    size_t last = min(total, first + MENU_PAGE_SIZE);
+    size_t width = cols - 14;   // "  " + text + " [function]"
+
+    redrawLine(input, continuation);
+    cout << COLOR_RESET << "\n\033[J";
+    for (size_t i = first; i < last; i++) {
+        uint32_t idx = comp.matches[i].index;
+        const CandidateSet::Item &it = comp.candidates.item(idx);
+        string text(comp.candidates.text(idx), min((size_t)it.len, width));
+        for (char &c : text) {
+            if ((unsigned char)c < ' ')
+                c = ' ';
+        }
+        if (it.kind == CAND_DIR)
+            text += "/";
+        cout << (i == selected ? "\033[7m> " : "  ") << text << COLOR_RESET << " "
+             << COLOR_YELLOW << "[" << candidateTags[it.kind] << "]" << COLOR_RESET << "\n";
+    }
+    cout << COLOR_PURPLE << "-- " << first + 1 << "-" << last << " of " << total
+         << " (TAB/arrows, PgUp/PgDn, Enter, Ctrl-G) --" << COLOR_RESET;
+    cout << "\033[" << (last - first + 1) << "A";
+    redrawLine(input, continuation);
+}
+
+static void closeMenu(const string &input, bool continuation) {
+    cout << "\r\033[J";
+    printPrompt(continuation);
+    paintInput(input);
+    cout.flush();
+}
+
+// TAB: ek match ho to seedha lagao, warna paged menu. Menu ko band karne wali
+// (navigation ke alawa) key pendingKey mein aati hai taaki readInput use process kare.
+// false = menu mein hi stdin khatam ho gaya.
+static bool completeInput(string &input, bool continuation, int &pendingKey) {
+    static Completion comp;
+    collectCompletions(comp, input);
+    size_t total = comp.matches.size();
+    if (total == 0) {
+        cout << "\a";
+        cout.flush();
+        return true;
+    }
+    if (total == 1) {
+        input = applyCompletion(comp, 0);
+        redrawLine(input, continuation);
+        return true;
+    }
+    size_t selected = 0;
+    while (true) {
+        input = applyCompletion(comp, selected);
+        drawMenu(comp, selected, input, continuation);
+        int c = getchar();
+        if (c == '\t') {
+            selected = (selected + 1) % total;
+        } else if (c == 27) {
+            int seq1 = getchar();
+            int seq2 = getchar();
+            if (seq1 != '[')
+                continue;
+            if (seq2 == 'B') {
+                selected = (selected + 1) % total;
+            } else if (seq2 == 'A' || seq2 == 'Z') {        // Up / Shift-TAB
+                selected = (selected + total - 1) % total;
+            } else if (seq2 == '5' || seq2 == '6') {        // PgUp / PgDn
+                getchar();                                  // '~'
+                size_t page = selected / MENU_PAGE_SIZE;
+                if (seq2 == '6')
+                    selected = min(total - 1, (page + 1) * MENU_PAGE_SIZE);
+                else
+                    selected = page > 0 ? (page - 1) * MENU_PAGE_SIZE : 0;
+            }
+        } else if (c == '\n') {
+            closeMenu(input, continuation);
+            return true;
+        } else if (c == 7 || c == 127 || c == 8 || c == EOF) {   // Ctrl-G / Backspace: cancel
+            input = comp.original;
+            closeMenu(input, continuation);
+            return c != EOF;
+        } else {
+            closeMenu(input, continuation);
+            pendingKey = c;
+            return true;
+        }
+    }
+}
+
+// ===================== Syntax Highlighting =====================
+
+// Typing ke saath line rangin: builtins / keywords, mile ya na mile commands,
+// strings, operators, redirections, comments. Lexer state har byte se pehle
+// save hota hai, isliye edit ke baad sirf pehle badle byte se aage re-lex hota
+// hai, aur terminal par sirf pehle badle rang / byte se aage dobara likha jata
+// hai. Command lookup ExecutableIndex (sorted PATH listing) se, access() nahi.
+// Kisi keystroke par kaam HIGHLIGHT_BUDGET_NS se zyada ho to baaki line saade
+// rang mein chhap ke agle keystroke par wahin se aage badhte hain.
+
+const uint64_t HIGHLIGHT_BUDGET_NS = 1000000;     // 1 ms per keystroke
+
+enum HighlightClass : uint8_t {
+    HL_TEXT, HL_BUILTIN, HL_KEYWORD, HL_COMMAND, HL_MISSING,
+    HL_STRING, HL_OPERATOR, HL_REDIRECT, HL_COMMENT
+};
+static const char *const highlightColors[] = {
+    COLOR_CYAN, "\033[1;32m", "\033[1;35m", COLOR_GREEN, COLOR_RED,
+    COLOR_YELLOW, COLOR_PURPLE, COLOR_BLUE, "\033[90m"
+};
+
+// Ek byte se pehle ka lexer state
+struct HighlightState {
+    uint32_t wordStart;     // inWord: word kahan shuru hua
+    char quote;             // 0, '\'' ya '"'
+    bool escape;            // pichla byte '\\' tha
+    bool inWord;
+    bool comment;           // '#' se line ke end tak
+    bool commandPos;        // agla word command ki jagah par hai
+    bool wordIsCommand;     // current word command ki jagah par shuru hua
+    bool wordIsTarget;      // current word redirection target hai
+    uint8_t subst;          // $( ... ) ke andar kitni gehrai
+    bool redirTarget;       // agla word redirection ka target hai
+    bool afterRedirOp;      // pichla byte '<' / '>' tha ('>&', '>>' ke liye)
+    bool noCommandNext;     // for / case / function ke baad ka naam
+};
+
+class LineHighlighter {
+public:
+    // Naya line: terminal par kuch nahi likha
+    void reset() {
+        shown.clear();
+        shownColors.clear();
+        text.clear();
+        colors.clear();
+        states.assign(1, initialState());
+        valid = 0;
+        pathMemo.clear();
+    }
+    // Command index badla: poori line dobara classify
+    void invalidate() { valid = 0; }
+
+    // Cursor line ke end par; input ka naya roop sirf badle hisse ko dobara likh ke dikhao
+    void update(const string &input) {
+        lex(input);
+        size_t d = 0;
+        while (d < shown.size() && d < input.size() && shown[d] == input[d] && shownColors[d] == colors[d])
+            d++;
+        if (d == shown.size() && d == input.size())
+            return;
+        string out;
+        size_t back = columns(shown, d);
+        if (back > 0)
+            out += "\033[" + to_string(back) + "D";
+        render(out, d);
+        if (shown.size() > input.size() || back > 0)
+            out += "\033[K";
+        cout << out;
+        cout.flush();
+        shown = input;
+        shownColors = colors;
+    }
+
+    // Prompt ke turant baad poori line likho (redraw, history, completion)
+    void paint(const string &input) {
+        lex(input);
+        string out;
+        render(out, 0);
+        cout << out;
+        shown = input;
+        shownColors = colors;
+    }
+
+private:
+    string shown;                   // terminal par jo abhi hai
+    vector<uint8_t> shownColors;
+    string text;                    // jis input ke liye colors / states hain
+    vector<uint8_t> colors;
+    vector<HighlightState> states;  // states[i] = byte i se pehle
+    size_t valid = 0;               // states[0..valid] bharosemand
+    unordered_map<string, bool> pathMemo;   // '/' wale commands (ek baar stat)
+
+    static HighlightState initialState() {
+        HighlightState s;
+        memset(&s, 0, sizeof(s));
+        s.commandPos = true;
+        return s;
+    }
+
+    static size_t columns(const string &s, size_t from) {
+        size_t cols = 0;
+        for (size_t i = from; i < s.size(); i++)
+            cols += ((unsigned char)s[i] & 0xC0) != 0x80;   // UTF-8 continuation bytes nahi
+        return cols;
+    }
+
+    // Terminal har render ke baad (aur prompt ke baad) HL_TEXT rang mein rehta hai
+    void render(string &out, size_t from) const {
+        int current = HL_TEXT;
+        for (size_t i = from; i < text.size(); i++) {
+            if (colors[i] != current) {
+                current = colors[i];
+                out += COLOR_RESET;
+                out += highlightColors[current];
+            }
+            out += text[i];
+        }
+        if (current != HL_TEXT) {
+            out += COLOR_RESET;
+            out += highlightColors[HL_TEXT];
+        }
+    }
+
+    HighlightClass classifyCommand(const char *w, size_t len) {
+        static const char *const keywords[] = {
+            "if", "then", "else", "elif", "fi", "while", "until", "do", "done",
+            "for", "in", "case", "esac", "function", "{", "}", "!"
+        };
+        string name(w, len);
+        for (const char *kw : keywords) {
+            if (name == kw)
+                return HL_KEYWORD;
+        }
+        if (findBuiltin(name.c_str()) || aliases.count(name) || functions.count(name))
+            return HL_BUILTIN;
+        if (name.find('/') != string::npos) {
+            auto it = pathMemo.find(name);
+            if (it == pathMemo.end())
+                it = pathMemo.emplace(name, access(name.c_str(), X_OK) == 0).first;
+            return it->second ? HL_COMMAND : HL_MISSING;
+        }
+        if (!executableIndex.ready())
+            return HL_TEXT;         // index abhi bana nahi: andaza mat lagao
+        return executableIndex.contains(w, len) ? HL_COMMAND : HL_MISSING;
+    }
+
+    // Word [start, end) ka rang tay karo (quoted bytes string hi rehte hain)
+    void finishWord(HighlightState &s, size_t end) {
+        size_t start = s.wordStart;
+        HighlightClass cls = HL_TEXT;
+        bool quoted = false, assignment = false;
+        for (size_t i = start; i < end; i++) {
+            char c = text[i];
+            if (c == '\'' || c == '"' || c == '\\' || c == '$' || c == '`')
+                quoted = true;
+            if (c == '=' && !quoted && i > start)
+                assignment = true;
+        }
+        if (s.wordIsCommand && !quoted && !assignment)
+            cls = classifyCommand(text.data() + start, end - start);
+        for (size_t i = start; i < end; i++) {
+            if (colors[i] != HL_STRING)
+                colors[i] = cls;
+        }
+        s.inWord = false;
+        if (s.wordIsTarget) {
+            // '> out cmd': target ke baad bhi command ki jagah waisi hi
+        } else if (s.wordIsCommand && assignment) {
+            s.commandPos = true;            // 'X=1 cmd'
+        } else if (s.wordIsCommand && cls == HL_KEYWORD) {
+            string kw(text.data() + start, end - start);
+            s.noCommandNext = kw == "for" || kw == "case" || kw == "function";
+            s.commandPos = !s.noCommandNext && kw != "fi" && kw != "done" && kw != "esac" && kw != "}";
+        } else {
+            s.commandPos = false;
+        }
+    }
+
+    void startWord(HighlightState &s, size_t i) {
+        s.inWord = true;
+        s.wordStart = (uint32_t)i;
+        s.wordIsCommand = s.commandPos && !s.redirTarget && !s.noCommandNext;
+        s.wordIsTarget = s.redirTarget;
+        if (s.redirTarget)
+            s.redirTarget = false;
+        else
+            s.noCommandNext = false;
+    }
+
+    // Byte i ko process karo: colors[i] set, s agle byte ka state banta hai
+    void step(HighlightState &s, size_t i) {
+        char c = text[i];
+        bool wasRedirOp = s.afterRedirOp;
+        s.afterRedirOp = false;
+        if (s.comment) {
+            colors[i] = HL_COMMENT;
+            return;
+        }
+        if (s.escape) {
+            s.escape = false;
+            colors[i] = s.quote ? HL_STRING : HL_TEXT;
+            return;
+        }
+        if (s.subst) {
+            // $(...) ka body string ki tarah (nested parens gin ke)
+            colors[i] = HL_STRING;
+            if (c == '(')
+                s.subst++;
+            else if (c == ')')
+                s.subst--;
+            return;
+        }
+        if (s.quote) {
+            colors[i] = HL_STRING;
+            if (c == s.quote)
+                s.quote = 0;
+            else if (c == '\\' && s.quote == '"')
+                s.escape = true;
+            return;
+        }
+        if (c == ' ' || c == '\t' || c == '\n') {
+            if (s.inWord)
+                finishWord(s, i);
+            colors[i] = HL_TEXT;
+            return;
+        }
+        if (c == '<' || c == '>' || (c == '&' && wasRedirOp)) {
+            if (s.inWord) {
+                bool digits = true;
+                for (size_t k = s.wordStart; k < i && digits; k++)
+                    digits = isdigit((unsigned char)text[k]) != 0;
+                if (digits) {               // "2>": fd number redirection ka hissa
+                    for (size_t k = s.wordStart; k < i; k++)
+                        colors[k] = HL_REDIRECT;
+                    s.inWord = false;
+                } else {
+                    finishWord(s, i);
+                }
+            }
+            colors[i] = HL_REDIRECT;
+            s.afterRedirOp = c != '&';
+            s.redirTarget = true;
+            return;
+        }
+        if (c == '(' && s.inWord && i > 0 && text[i - 1] == '$') {
+            s.subst = 1;
+            colors[i - 1] = colors[i] = HL_STRING;
+            return;
+        }
+        if (c == '|' || c == '&' || c == ';' || c == '(' || c == ')') {
+            if (s.inWord)
+                finishWord(s, i);
+            colors[i] = HL_OPERATOR;
+            s.commandPos = true;
+            s.redirTarget = s.noCommandNext = false;
+            return;
+        }
+        if (!s.inWord) {
+            if (c == '#') {
+                s.comment = true;
+                colors[i] = HL_COMMENT;
+                return;
+            }
+            startWord(s, i);
+        }
+        colors[i] = HL_TEXT;
+        if (c == '\'' || c == '"' || c == '`') {
+            s.quote = c;
+            colors[i] = HL_STRING;
+        } else if (c == '\\') {
+            s.escape = true;
+        }
+    }
+
+    // text/colors/states ko input tak lao, pehle badle byte se shuru karke
+    void lex(const string &input) {
+        uint64_t startNs = clockNs();
+        size_t p = 0;
+        size_t limit = min(min(text.size(), input.size()), valid);
+        while (p < limit && text[p] == input[p])
+            p++;
+        text = input;
+        colors.resize(input.size());
+        states.resize(p + 1);
+        HighlightState s = states[p];
+        // Pichle lex ne khula word line ke end par classify kiya tha; naye end par dobara hoga
+        size_t i = p;
+        for (; i < input.size(); i++) {
+            if ((i & 63) == 0 && i > p && clockNs() - startNs > HIGHLIGHT_BUDGET_NS)
+                break;
+            step(s, i);
+            states.push_back(s);
+        }
+        if (i < input.size()) {
+            // Budget khatam: baaki saada, agli baar yahin se
+            for (size_t k = i; k < input.size(); k++)
+                colors[k] = HL_TEXT;
+            valid = i;
+            return;
+        }
+        valid = input.size();
+        if (s.inWord)
+            finishWord(s, input.size());    // adhoora word bhi (state save nahi hota)
+    }
+};
+
+LineHighlighter lineHighlighter;
+
+// redrawLine / history: prompt ke baad poori line
+void paintInput(const string &input) {
+    lineHighlighter.paint(input);
+}
+
+// ===================== readInput() with Autocomplete & History =====================
+
+// Function arrow keys, TAB, Ctrl-D handle karta hai.
+string readInput(bool continuation) {
+    string input;
+    syncHistory(history, false);
+    size_t historyIndex = historyVector.size(); 
+    lineHighlighter.reset();
+    if (executableIndex.ready())
+        executableIndex.update();           // PATH / directories badle ho to
+    printPrompt(continuation);
+    int c;
+    int pending = -1;                       // completion menu ne jo key lauta di
+    while (true) {
+        if (!executableIndex.ready() && pending < 0) {
+            // Index pehli baar tab banao jab koi key intezaar mein na ho (idle time)
+            struct pollfd p = {STDIN_FILENO, POLLIN, 0};
+            if (poll(&p, 1, 0) == 0) {
+                executableIndex.update();
+                lineHighlighter.invalidate();
+                lineHighlighter.update(input);
+            }
+        }
+        if (pending >= 0) {
+            c = pending;
+            pending = -1;
+        } else if ((c = getchar()) == EOF) {
+            break;
+        }
+        if (c == '\n') {
+            cout << COLOR_RESET << "\n";
+            break;
+        }
+        if (c == 27) {                      // Arrow keys ke liye escape seq
+            int seq1 = getchar();
+            int seq2 = getchar();
+            if (seq1 == '[') {
+                if (seq2 == 'A') {          // UP arrow 
+                    if (historyIndex == historyVector.size()) {
+                        // Navigation shuru: dusre sessions ke naye records le lo
+                        syncHistory(history, false);
+                        historyIndex = historyVector.size();
+                    }
+                    if (!historyVector.empty() && historyIndex > 0) {
+                        historyIndex--;
+                        input = historyVector[historyIndex];
+                        cout << "\r\033[K"; // line clear karo
+                        printPrompt(continuation);
+                        paintInput(input);
+                    }
+                } else if (seq2 == 'B') {   // DOWN arrow 
+                    if (!historyVector.empty() && historyIndex < historyVector.size() - 1) {
+                        historyIndex++;
+                        input = historyVector[historyIndex];
+                        cout << "\r\033[K";
+                        printPrompt(continuation);
+                        paintInput(input);
+                    } else {
+                        // Sabse recent history pe pohonch gaye, to input clear karo
+                        historyIndex = historyVector.size();
+                        input = "";
+                        cout << "\r\033[K";
+                        printPrompt(continuation);
+                        paintInput(input);
+                    }
+                }
+            }
+            continue;
+        } else if (c == '\t') {
+            if (!completeInput(input, continuation, pending)) {
+                c = EOF;
+                break;
+            }
+            continue;
+        } else if (c == 127 || c == 8) {    // Backspace key
+            if (!input.empty()) {
+                input.pop_back();
+                lineHighlighter.update(input);
+            }
+            continue;
+        } else if (c == 4) {                // Ctrl-D: exit if no input
+            if (input.empty()) {
+                cout << "\n";
+                exit(0);
+            }
+            break;
+        } else {
+            input.push_back((char)c);
+            lineHighlighter.update(input);
+        }
+    }
+    if (c == EOF && input.empty()) {
+        // stdin khatam (Ctrl-D jaisa)
+        cout << COLOR_RESET << "\n";
+        resetTerminal();
+        exit(lastStatus);
+    }
+    return input;
+}
+
+// ===================== findExecutablePath Helper =====================
+
+// Candidate path stack buffer mein banao; sirf match hone par arena string banti hai
+static bool probeExecutable(const char *dir, size_t dirLen, const char *name, size_t nameLen,
+                            char *fullPath) {
+    if (dirLen + 1 + nameLen >= PATH_MAX)
+        return false;
+    memcpy(fullPath, dir, dirLen);
+    fullPath[dirLen] = '/';
+    memcpy(fullPath + dirLen + 1, name, nameLen);
+    fullPath[dirLen + 1 + nameLen] = '\0';
+    if (access(fullPath, X_OK) != 0)
+        return false;
+    return strstr(fullPath, "Xorg.wrap") == nullptr;
+}
+
+ArenaString findExecutablePath(const char *cmd) {
+    const char *start = cmd;
+    while (*start == ' ' || *start == '\t')
+        start++;
+    size_t len = strlen(start);
+    while (len > 0 && (start[len - 1] == ' ' || start[len - 1] == '\t'))
+        len--;
+    if (len == 0)
+        return ArenaString();
+    if (memchr(start, '/', len) != nullptr)
+        return ArenaString(start, len);
+    char fullPath[PATH_MAX];
+    static const char *const commonDirs[] = {"/bin", "/usr/bin", "/usr/local/bin"};
+    for (const char *dir : commonDirs) {
+        if (probeExecutable(dir, strlen(dir), start, len, fullPath))
+            return ArenaString(fullPath);
+    }
+    const char *pathEnv = getenv("PATH");
+    while (pathEnv && *pathEnv) {
+        const char *colon = strchr(pathEnv, ':');
+        size_t dirLen = colon ? (size_t)(colon - pathEnv) : strlen(pathEnv);
+        if (dirLen > 0 && probeExecutable(pathEnv, dirLen, start, len, fullPath))
+            return ArenaString(fullPath);
+        pathEnv = colon ? colon + 1 : nullptr;
+    }
+    return ArenaString();
+}
+
+// ===================== Lexer & Parser =====================
+
+enum TokenKind {
+    T_WORD, T_NEWLINE, T_SEMI, T_AMP, T_AND_IF, T_OR_IF, T_PIPE,
+    T_LPAREN, T_RPAREN, T_DSEMI, T_REDIR, T_EOF
+};
+
+// Recursive-descent parser (POSIX grammar ka subset):
+//   list     := and_or ((';' | '&' | NEWLINE) and_or)*
+//   and_or   := pipeline (('&&' | '||') pipeline)*
+//   pipeline := ['!'] command ('|' command)*
+//   command  := simple | '{' list '}' | '(' list ')' | if | while | until
+//               | for | case | NAME '(' ')' command | 'function' NAME command
+class Parser {
+public:
+    Parser(const char *src, size_t len, Arena &arena)
+        : failed(false), incomplete(false), pos(src), end(src + len), arena(arena),
+          lit(ArenaAllocator<char>(&arena)), tok(T_EOF), tokWord(nullptr),
+          redirKind(R_IN), redirFd(0) {}
+
+    Node *parseProgram();
+    bool failed;            // syntax error
+    bool incomplete;        // input beech mein khatam hua (aur lines chahiye)
+
+private:
+    const char *pos, *end;
+    Arena &arena;
+    ArenaString lit;        // current literal part ka buffer
+    TokenKind tok;
+    Word *tokWord;
+    RedirKind redirKind;
+    int redirFd;
+
+    template <class T> T *make() {
+        T *p = static_cast<T*>(arena.allocate(sizeof(T), alignof(T)));
+        memset(p, 0, sizeof(T));
+        return p;
+    }
+
+    void advance();
+    Word *lexWord();
+    bool lexDollar(WordPart **&tail, bool quoted);
+    void lexCommandSubst(WordPart **&tail, bool quoted);
+    void lexBackquote(WordPart **&tail, bool quoted);
+    void addCommandPart(WordPart **&tail, bool quoted, const char *text, size_t len, Node *program);
+    void flushLiteral(WordPart **&tail, bool quoted);
+    WordPart *addPart(WordPart **&tail, WordPartKind kind, bool quoted, const char *text, size_t len);
+    bool isKeyword(const char *kw) const;
+    bool atListEnd() const;
+    void skipNewlines() { while (tok == T_NEWLINE) advance(); }
+    bool expectKeyword(const char *kw);
+    bool fail();
+
+    Node *parseList();
+    Node *parseAndOr();
+    Node *parsePipeline();
+    Node *parseCommand();
+    Node *parseSimple();
+    Node *parseIf();
+    Node *parseLoop(NodeKind kind);
+    Node *parseFor();
+    Node *parseCase();
+    Node *parseFunction(const char *name);
+    Node *parseGroup(NodeKind kind, TokenKind closeTok, const char *closeKw);
+    bool parseRedirects(Redir **&tail);
+    bool parseRedirect(Redir **&tail);
+};
+
+static bool isNameStart(char c) { return isalpha((unsigned char)c) || c == '_'; }
+static bool isNameChar(char c) { return isalnum((unsigned char)c) || c == '_'; }
+static bool isMetaChar(char c) {
+    return c == ' ' || c == '\t' || c == '\n' || c == ';' || c == '&' || c == '|' ||
+           c == '<' || c == '>' || c == '(' || c == ')';
+}
+
+bool Parser::fail() {
+    if (!failed && !incomplete) {
+        failed = true;
+        if (tok == T_EOF) {
+            incomplete = true;
+            failed = false;
+        }
+    }
+    return false;
+}
+
+WordPart *Parser::addPart(WordPart **&tail, WordPartKind kind, bool quoted, const char *text,
+                          size_t len) {
+    WordPart *part = make<WordPart>();
+    part->kind = kind;
+    part->quoted = quoted;
+    part->text = arena.copy(text, len);
+    part->len = len;
+    *tail = part;
+    tail = &part->next;
+    return part;
+}
+
+void Parser::flushLiteral(WordPart **&tail, bool quoted) {
+    if (lit.empty())
+        return;
+    addPart(tail, WP_LITERAL, quoted, lit.data(), lit.size());
+    lit.clear();
+}
+
+// '$' ke baad: $((expr)), ${name}, $name, $?, $$, $#, $@, $*, $0-$9.
+// Kuch match na ho to '$' literal hai (false return).
+bool Parser::lexDollar(WordPart **&tail, bool quoted) {
+    const char *p = pos + 1;
+    if (p + 1 < end && p[0] == '(' && p[1] == '(') {
+        int depth = 0;
+        for (const char *q = p + 2; q < end; q++) {
+            if (*q == '(')
+                depth++;
+            else if (*q == ')') {
+                if (depth == 0 && q + 1 < end && q[1] == ')') {
+                    flushLiteral(tail, quoted);
+                    addPart(tail, WP_ARITH, quoted, p + 2, q - (p + 2));
+                    pos = q + 2;
+                    return true;
+                }
+                depth--;
+            }
+        }
+        pos = end;
+        incomplete = true;
+        return true;
+    }
+    if (p < end && *p == '(') {
+        lexCommandSubst(tail, quoted);
+        return true;
+    }
+    if (p < end && *p == '{') {
+        const char *close = static_cast<const char*>(memchr(p, '}', end - p));
+        if (!close) {
+            pos = end;
+            incomplete = true;
+            return true;
+        }
+        flushLiteral(tail, quoted);
+        addPart(tail, WP_PARAM, quoted, p + 1, close - p - 1);
+        pos = close + 1;
+        return true;
+    }
+    if (p < end && isNameStart(*p)) {
+        const char *q = p;
+        while (q < end && isNameChar(*q))
+            q++;
+        flushLiteral(tail, quoted);
+        addPart(tail, WP_PARAM, quoted, p, q - p);
+        pos = q;
+        return true;
+    }
+    if (p < end && (strchr("?$#@*", *p) || isdigit((unsigned char)*p))) {
+        flushLiteral(tail, quoted);
+        addPart(tail, WP_PARAM, quoted, p, 1);
+        pos = p + 1;
+        return true;
+    }
+    return false;
+}
+
+void Parser::addCommandPart(WordPart **&tail, bool quoted, const char *text, size_t len,
+                            Node *program) {
+    flushLiteral(tail, quoted);
+    addPart(tail, WP_COMMAND, quoted, text, len)->program = program;
+}
+
+// $( list ): andar ka text nested parser se yahin ek baar parse hota hai; wahi
+// parser matching ')' dhoondta hai (quotes, nested $(...) aur case patterns samet).
+void Parser::lexCommandSubst(WordPart **&tail, bool quoted) {
+    const char *start = pos + 2;
+    Parser inner(start, end - start, arena);
+    inner.advance();
+    Node *program = inner.parseList();
+    if (inner.incomplete || (!inner.failed && inner.tok == T_EOF)) {
+        pos = end;
+        incomplete = true;
+        return;
+    }
+    if (inner.failed || inner.tok != T_RPAREN) {
+        pos = end;
+        failed = true;
+        return;
+    }
+    addCommandPart(tail, quoted, start, inner.pos - 1 - start, program);
+    pos = inner.pos;
+}
+
+// `...`: closing backquote tak; \$, \` aur \\ se backslash hatake andar ka text parse
+void Parser::lexBackquote(WordPart **&tail, bool quoted) {
+    ArenaString text{ArenaAllocator<char>(&arena)};
+    const char *p = pos + 1;
+    while (p < end && *p != '`') {
+        if (*p == '\\' && p + 1 < end && (p[1] == '$' || p[1] == '`' || p[1] == '\\'))
+            p++;
+        text.push_back(*p++);
+    }
+    if (p >= end) {
+        pos = end;
+        incomplete = true;
+        return;
+    }
+    const char *src = arena.copy(text.data(), text.size());
+    Parser inner(src, text.size(), arena);
+    Node *program = inner.parseProgram();
+    if (inner.failed || inner.incomplete) {
+        pos = end;
+        failed = true;
+        return;
+    }
+    addCommandPart(tail, quoted, src, text.size(), program);
+    pos = p + 1;
+}
+
+Word *Parser::lexWord() {
+    Word *w = make<Word>();
+    w->raw = pos;
+    w->plain = true;
+    WordPart **tail = &w->parts;
+    lit.clear();
+    while (pos < end && !isMetaChar(*pos)) {
+        char c = *pos;
+        if (c == '\\') {
+            w->plain = false;
+            if (pos + 1 < end && pos[1] != '\n')
+                lit.push_back(pos[1]);
+            pos += (pos + 1 < end) ? 2 : 1;
+        } else if (c == '\'') {
+            w->plain = false;
+            w->hasQuotes = true;
+            const char *close = static_cast<const char*>(memchr(pos + 1, '\'', end - pos - 1));
+            if (!close) {
+                pos = end;
+                incomplete = true;
+                break;
+            }
+            lit.append(pos + 1, close - pos - 1);
+            pos = close + 1;
+        } else if (c == '"') {
+            w->plain = false;
+            w->hasQuotes = true;
+            flushLiteral(tail, false);
+            pos++;
+            bool closed = false;
+            while (pos < end) {
+                char d = *pos;
+                if (d == '"') {
+                    closed = true;
+                    pos++;
+                    break;
+                }
+                if (d == '\\' && pos + 1 < end && strchr("$`\"\\\n", pos[1])) {
+                    if (pos[1] != '\n')
+                        lit.push_back(pos[1]);
+                    pos += 2;
+                } else if (d == '$' && lexDollar(tail, true)) {
+                    continue;
+                } else if (d == '`') {
+                    lexBackquote(tail, true);
+                } else {
+                    lit.push_back(d);
+                    pos++;
+                }
+            }
+            flushLiteral(tail, true);
+            if (!closed) {
+                incomplete = true;
+                break;
+            }
+        } else if (c == '$' && lexDollar(tail, false)) {
+            w->plain = false;
+        } else if (c == '`') {
+            w->plain = false;
+            lexBackquote(tail, false);
+        } else {
+            lit.push_back(c);
+            pos++;
+        }
+    }
+    flushLiteral(tail, false);
+    w->rawLen = pos - w->raw;
+    return w;
+}
+
+void Parser::advance() {
+    tokWord = nullptr;
+    // Whitespace, line continuation aur comments skip karo
+    while (pos < end) {
+        if (*pos == ' ' || *pos == '\t')
+            pos++;
+        else if (*pos == '\\' && pos + 1 < end && pos[1] == '\n')
+            pos += 2;
+        else if (*pos == '#') {
+            while (pos < end && *pos != '\n')
+                pos++;
+        } else
+            break;
+    }
+    if (pos >= end) {
+        tok = T_EOF;
+        return;
+    }
+    // IO number: "2>" jaisa prefix
+    const char *p = pos;
+    int fd = -1;
+    if (isdigit((unsigned char)*p)) {
+        while (p < end && isdigit((unsigned char)*p))
+            p++;
+        if (p < end && (*p == '<' || *p == '>'))
+            fd = atoi(pos);
+        else
+            p = pos;
+    }
+    char c = *p;
+    char n = (p + 1 < end) ? p[1] : '\0';
+    if (c == '<' || c == '>') {
+        tok = T_REDIR;
+        redirFd = (fd >= 0) ? fd : (c == '<' ? 0 : 1);
+        if (c == '>' && n == '>') {
+            redirKind = R_APPEND;
+            pos = p + 2;
+        } else if (n == '&') {
+            redirKind = R_DUP;
+            pos = p + 2;
+        } else {
+            redirKind = (c == '<') ? R_IN : R_OUT;
+            pos = p + 1;
+        }
+        return;
+    }
+    pos++;
+    switch (c) {
+    case '\n': tok = T_NEWLINE; return;
+    case '(': tok = T_LPAREN; return;
+    case ')': tok = T_RPAREN; return;
+    case ';':
+        if (n == ';') { pos++; tok = T_DSEMI; } else tok = T_SEMI;
+        return;
+    case '&':
+        if (n == '&') { pos++; tok = T_AND_IF; } else tok = T_AMP;
+        return;
+    case '|':
+        if (n == '|') { pos++; tok = T_OR_IF; } else tok = T_PIPE;
+        return;
+    default:
+        pos--;
+        tok = T_WORD;
+        tokWord = lexWord();
+    }
+}
+
+// Reserved words sirf tab jab word bilkul plain ho (quoted "if" ek normal word hai)
+bool Parser::isKeyword(const char *kw) const {
+    return tok == T_WORD && tokWord->plain && tokWord->rawLen == strlen(kw) &&
+           memcmp(tokWord->raw, kw, tokWord->rawLen) == 0;
+}
+
+bool Parser::atListEnd() const {
+    if (tok == T_EOF || tok == T_RPAREN || tok == T_DSEMI)
+        return true;
+    static const char *const enders[] = {"then", "else", "elif", "fi", "do", "done", "esac", "}"};
+    for (const char *kw : enders) {
+        if (isKeyword(kw))
+            return true;
+    }
+    return false;
+}
+
+bool Parser::expectKeyword(const char *kw) {
+    if (!isKeyword(kw))
+        return fail();
+    advance();
+    return true;
+}
+
+Node *Parser::parseProgram() {
+    advance();
+    Node *list = parseList();
+    if (!failed && !incomplete && tok != T_EOF)
+        fail();
+    return (failed || incomplete) ? nullptr : list;
+}
+
+Node *Parser::parseList() {
+    Node *head = nullptr;
+    Node **tail = &head;
+    skipNewlines();
+    while (!atListEnd()) {
+        Node *n = parseAndOr();
+        if (!n)
+            return nullptr;
+        *tail = n;
+        tail = &n->next;
+        if (tok == T_SEMI || tok == T_NEWLINE) {
+            advance();
+        } else if (tok == T_AMP) {
+            n->background = true;
+            advance();
+        } else {
+            break;
+        }
+        skipNewlines();
+    }
+    return head;
+}
+
+Node *Parser::parseAndOr() {
+    Node *left = parsePipeline();
+    while (left && (tok == T_AND_IF || tok == T_OR_IF)) {
+        Node *n = make<Node>();
+        n->kind = (tok == T_AND_IF) ? N_AND : N_OR;
+        advance();
+        skipNewlines();
+        n->cond = left;
+        n->body = parsePipeline();
+        if (!n->body)
+            return nullptr;
+        left = n;
+    }
+    return left;
+}
+
+Node *Parser::parsePipeline() {
+    bool negate = false;
+    if (isKeyword("!")) {
+        negate = true;
+        advance();
+    }
+    Node *first = parseCommand();
+    if (!first)
+        return nullptr;
+    if (tok != T_PIPE && !negate)
+        return first;
+    Node *pipeline = make<Node>();
+    pipeline->kind = N_PIPELINE;
+    pipeline->negate = negate;
+    pipeline->cond = first;
+    Node *last = first;
+    while (tok == T_PIPE) {
+        advance();
+        skipNewlines();
+        Node *stage = parseCommand();
+        if (!stage)
+            return nullptr;
+        last->next = stage;
+        last = stage;
+    }
+    return pipeline;
+}
+
+Node *Parser::parseCommand() {
+    Node *n = nullptr;
+    if (tok == T_LPAREN) {
+        advance();
+        n = parseGroup(N_SUBSHELL, T_RPAREN, nullptr);
+    } else if (isKeyword("{")) {
+        advance();
+        n = parseGroup(N_GROUP, T_EOF, "}");
+    } else if (isKeyword("if")) {
+        n = parseIf();
+    } else if (isKeyword("while")) {
+        n = parseLoop(N_WHILE);
+    } else if (isKeyword("until")) {
+        n = parseLoop(N_UNTIL);
+    } else if (isKeyword("for")) {
+        n = parseFor();
+    } else if (isKeyword("case")) {
+        n = parseCase();
+    } else if (isKeyword("function")) {
+        advance();
+        if (tok != T_WORD || !tokWord->plain || !isNameStart(tokWord->raw[0])) {
+            fail();
+            return nullptr;
+        }
+        const char *name = arena.copy(tokWord->raw, tokWord->rawLen);
+        advance();
+        if (tok == T_LPAREN) {
+            advance();
+            if (tok != T_RPAREN) {
+                fail();
+                return nullptr;
+            }
+            advance();
+        }
+        return parseFunction(name);
+    } else {
+        return parseSimple();
+    }
+    if (!n)
+        return nullptr;
+    // Compound command ke baad redirections (e.g. 'done > out.txt')
+    Redir **tail = &n->redirs;
+    if (!parseRedirects(tail))
+        return nullptr;
+    return n;
+}
+
+bool Parser::parseRedirect(Redir **&tail) {
+    Redir *r = make<Redir>();
+    r->kind = redirKind;
+    r->fd = redirFd;
+    advance();
+    if (tok != T_WORD)
+        return fail();
+    r->target = tokWord;
+    advance();
+    *tail = r;
+    tail = &r->next;
+    return true;
+}
+
+bool Parser::parseRedirects(Redir **&tail) {
+    while (tok == T_REDIR) {
+        if (!parseRedirect(tail))
+            return false;
+    }
+    return true;
+}
+
+Node *Parser::parseSimple() {
+    Node *n = make<Node>();
+    n->kind = N_SIMPLE;
+    Word **wordTail = &n->words;
+    Word **assignTail = &n->assigns;
+    Redir **redirTail = &n->redirs;
+    while (true) {
+        if (tok == T_REDIR) {
+            if (!parseRedirect(redirTail))
+                return nullptr;
+        } else if (tok == T_WORD) {
+            Word *w = tokWord;
+            const char *eq = static_cast<const char*>(memchr(w->raw, '=', w->rawLen));
+            bool isAssign = n->words == nullptr && eq && eq > w->raw && isNameStart(w->raw[0]);
+            for (const char *q = w->raw; isAssign && q < eq; q++)
+                isAssign = isNameChar(*q);
+            if (isAssign) {
+                // "NAME=" pehle literal part ka prefix hai: use hata kar value bachao
+                size_t prefix = eq - w->raw + 1;
+                w->assignName = arena.copy(w->raw, prefix - 1);
+                WordPart *first = w->parts;
+                first->text += prefix;
+                first->len -= prefix;
+                if (first->len == 0)
+                    w->parts = first->next;
+                *assignTail = w;
+                assignTail = &w->next;
+                advance();
+                continue;
+            }
+            bool firstWord = n->words == nullptr && n->assigns == nullptr && n->redirs == nullptr;
+            advance();
+            if (firstWord && tok == T_LPAREN && w->plain && isNameStart(w->raw[0])) {
+                advance();
+                if (tok != T_RPAREN) {
+                    fail();
+                    return nullptr;
+                }
+                advance();
+                return parseFunction(arena.copy(w->raw, w->rawLen));
+            }
+            *wordTail = w;
+            wordTail = &w->next;
+        } else {
+            break;
+        }
+    }
+    if (!n->words && !n->assigns && !n->redirs) {
+        fail();
+        return nullptr;
+    }
+    return n;
+}
+
+Node *Parser::parseFunction(const char *name) {
+    skipNewlines();
+    Node *body = parseCommand();
+    if (!body)
+        return nullptr;
+    if (body->kind == N_SIMPLE || body->kind == N_FUNCDEF) {
+        fail();
+        return nullptr;
+    }
+    Node *n = make<Node>();
+    n->kind = N_FUNCDEF;
+    n->name = name;
+    n->body = body;
+    return n;
+}
+
+Node *Parser::parseGroup(NodeKind kind, TokenKind closeTok, const char *closeKw) {
+    Node *n = make<Node>();
+    n->kind = kind;
+    n->cond = parseList();
+    if (failed || incomplete)
+        return nullptr;
+    if (closeKw) {
+        if (!expectKeyword(closeKw))
+            return nullptr;
+    } else {
+        if (tok != closeTok) {
+            fail();
+            return nullptr;
+        }
+        advance();
+    }
+    return n;
+}
+
+Node *Parser::parseIf() {
+    advance();      // 'if' / 'elif'
+    Node *n = make<Node>();
+    n->kind = N_IF;
+    n->cond = parseList();
+    if (failed || incomplete || !expectKeyword("then"))
+        return nullptr;
+    n->body = parseList();
+    if (failed || incomplete)
+        return nullptr;
+    if (isKeyword("elif")) {
+        n->elseBody = parseIf();        // 'fi' nested if consume karta hai
+        if (!n->elseBody)
+            return nullptr;
+        return n;
+    }
+    if (isKeyword("else")) {
+        advance();
+        n->elseBody = parseList();
+        if (failed || incomplete)
+            return nullptr;
+    }
+    if (!expectKeyword("fi"))
+        return nullptr;
+    return n;
+}
+
+Node *Parser::parseLoop(NodeKind kind) {
+    advance();      // 'while' / 'until'
+    Node *n = make<Node>();
+    n->kind = kind;
+    n->cond = parseList();
+    if (failed || incomplete || !expectKeyword("do"))
+        return nullptr;
+    n->body = parseList();
+    if (failed || incomplete || !expectKeyword("done"))
+        return nullptr;
+    return n;
+}
+
+Node *Parser::parseFor() {
+    advance();      // 'for'
+    if (tok != T_WORD || !tokWord->plain || !isNameStart(tokWord->raw[0])) {
+        fail();
+        return nullptr;
+    }
+    Node *n = make<Node>();
+    n->kind = N_FOR;
+    n->name = arena.copy(tokWord->raw, tokWord->rawLen);
+    advance();
+    skipNewlines();
+    if (isKeyword("in")) {
+        n->hasItems = true;
+        advance();
+        Word **tail = &n->words;
+        while (tok == T_WORD) {
+            *tail = tokWord;
+            tail = &tokWord->next;
+            advance();
+        }
+    }
+    if (tok == T_SEMI || tok == T_NEWLINE)
+        advance();
+    skipNewlines();
+    if (!expectKeyword("do"))
+        return nullptr;
+    n->body = parseList();
+    if (failed || incomplete || !expectKeyword("done"))
+        return nullptr;
+    return n;
+}
+
+Node *Parser::parseCase() {
+    advance();      // 'case'
+    if (tok != T_WORD) {
+        fail();
+        return nullptr;
+    }
+    Node *n = make<Node>();
+    n->kind = N_CASE;
+    n->words = tokWord;
+    advance();
+    skipNewlines();
+    if (!expectKeyword("in"))
+        return nullptr;
+    skipNewlines();
+    CaseItem **tail = &n->cases;
+    while (!isKeyword("esac")) {
+        if (tok == T_LPAREN)
+            advance();
+        CaseItem *item = make<CaseItem>();
+        Word **patTail = &item->patterns;
+        while (true) {
+            if (tok != T_WORD) {
+                fail();
+                return nullptr;
+            }
+            *patTail = tokWord;
+            patTail = &tokWord->next;
+            advance();
+            if (tok != T_PIPE)
+                break;
+            advance();
+        }
+        if (tok != T_RPAREN) {
+            fail();
+            return nullptr;
+        }
+        advance();
+        item->body = parseList();
+        if (failed || incomplete)
+            return nullptr;
+        *tail = item;
+        tail = &item->next;
+        if (tok == T_DSEMI) {
+            advance();
+            skipNewlines();
+        } else if (!isKeyword("esac")) {
+            fail();
+            return nullptr;
+        }
+    }
+    advance();      // 'esac'
+    return n;
+}
+
+// Text ko AST mein parse karta hai. Adhoora input (khula quote, 'fi'/'done'
+// missing) PARSE_INCOMPLETE deta hai taaki interactive loop aur lines padhe.
+Node *parseProgram(const char *src, size_t len, Arena &arena, ParseStatus &status) {
+    Parser parser(src, len, arena);
+    Node *program = parser.parseProgram();
+    status = parser.incomplete ? PARSE_INCOMPLETE : (parser.failed ? PARSE_ERROR : PARSE_OK);
+    if (parser.failed && !parser.incomplete)
+        cerr << "ishell: syntax error near unexpected token\n";
+    return program;
+}
+
+// Function body ko uske apne arena mein deep-copy karta hai
+static Word *cloneWords(Arena &arena, const Word *w);
+static Node *cloneNode(Arena &arena, const Node *n);
+
+template <class T>
+static T *cloneRaw(Arena &arena, const T *src) {
+    T *dst = static_cast<T*>(arena.allocate(sizeof(T), alignof(T)));
+    memcpy(dst, src, sizeof(T));
+    return dst;
+}
+
+static const char *cloneText(Arena &arena, const char *s, size_t len) {
+    return s ? arena.copy(s, len) : nullptr;
+}
+
+static Word *cloneWords(Arena &arena, const Word *w) {
+    Word *head = nullptr;
+    Word **tail = &head;
+    for (; w; w = w->next) {
+        Word *c = cloneRaw(arena, w);
+        c->raw = cloneText(arena, w->raw, w->rawLen);
+        c->assignName = w->assignName ? cloneText(arena, w->assignName, strlen(w->assignName)) : nullptr;
+        WordPart **partTail = &c->parts;
+        for (const WordPart *p = w->parts; p; p = p->next) {
+            WordPart *cp = cloneRaw(arena, p);
+            cp->text = cloneText(arena, p->text, p->len);
+            cp->program = cloneNode(arena, p->program);
+            *partTail = cp;
+            partTail = &cp->next;
+        }
+        *partTail = nullptr;
+        *tail = c;
+        tail = &c->next;
+    }
+    *tail = nullptr;
+    return head;
+}
+
+static Node *cloneNode(Arena &arena, const Node *n) {
+    Node *head = nullptr;
+    Node **tail = &head;
+    for (; n; n = n->next) {
+        Node *c = cloneRaw(arena, n);
+        c->assigns = cloneWords(arena, n->assigns);
+        c->words = cloneWords(arena, n->words);
+        Redir **redirTail = &c->redirs;
+        for (const Redir *r = n->redirs; r; r = r->next) {
+            Redir *cr = cloneRaw(arena, r);
+            cr->target = cloneWords(arena, r->target);
+            *redirTail = cr;
+            redirTail = &cr->next;
+        }
+        *redirTail = nullptr;
+        c->cond = cloneNode(arena, n->cond);
+        c->body = cloneNode(arena, n->body);
+        c->elseBody = cloneNode(arena, n->elseBody);
+        c->name = n->name ? cloneText(arena, n->name, strlen(n->name)) : nullptr;
+        CaseItem **caseTail = &c->cases;
+        for (const CaseItem *ci = n->cases; ci; ci = ci->next) {
+            CaseItem *cc = cloneRaw(arena, ci);
+            cc->patterns = cloneWords(arena, ci->patterns);
+            cc->body = cloneNode(arena, ci->body);
+            *caseTail = cc;
+            caseTail = &cc->next;
+        }
+        *caseTail = nullptr;
+        *tail = c;
+        tail = &c->next;
+    }
+    *tail = nullptr;
+    return head;
+}
+
+// ===================== Arithmetic Evaluator =====================
+
+static void skipSpaces(const char *s, size_t &i) {
+    while (s[i] && isspace((unsigned char)s[i]))
+        i++;
+}
+
+// Error par shell exit nahi hota: message (ek expansion mein ek hi baar) aur
+// expansionFailed, taaki current command status 1 ke saath fail ho
+static long long arithError(const char *message) {
+    if (!expansionFailed)
+        cerr << "ishell: " << message << " in arithmetic expression\n";
+    expansionFailed = true;
+    return 0;
+}
+
+// recursive-descent parser arithmetic expressions evaluate karta hai
+long long parseExpression(const char *s, size_t &i) {
+    long long result = parseTerm(s, i);
+    skipSpaces(s, i);
+    while (s[i]) {
+        if (s[i] == '+') {
+            i++;
+            result += parseTerm(s, i);
+        } else if (s[i] == '-') {
+            i++;
+            result -= parseTerm(s, i);
+        } else {
+            break;
+        }
+        skipSpaces(s, i);
+    }
+    return result;
+}
+
+long long parseTerm(const char *s, size_t &i) {
+    long long result = parseFactor(s, i);
+    skipSpaces(s, i);
+    while (s[i]) {
+        if (s[i] == '*') {
+            i++;
+            result *= parseFactor(s, i);
+        } else if (s[i] == '/' || s[i] == '%') {
+            char op = s[i++];
+            long long divisor = parseFactor(s, i);
+            if (divisor == 0)
+                result = arithError("division by zero");
+            else if (divisor == -1)
+                result = (op == '/') ? (long long)(0ull - (unsigned long long)result) : 0;   // LLONG_MIN / -1 par SIGFPE nahi
+            else
+                result = (op == '/') ? result / divisor : result % divisor;
+        } else {
+            break;
+        }
+        skipSpaces(s, i);
+    }
+    return result;
+}
+
+long long parseFactor(const char *s, size_t &i) {
+    skipSpaces(s, i);
     long long result = 0;
-    if (i < s.size() && s[i] == '(') {
+    if (s[i] == '(') {
         i++; // '(' ko skip karo
         result = parseExpression(s, i);
-        if (i < s.size() && s[i] == ')')
+        skipSpaces(s, i);
+        if (s[i] == ')')
+            i++;
+        else
+            result = arithError("missing closing parenthesis");
+    } else if (s[i] == '$' || isalpha((unsigned char)s[i]) || s[i] == '_') {
+        // Variable: naam ya $naam, value integer ki tarah padho (unset = 0)
+        if (s[i] == '$')
+            i++;
+        size_t start = i;
+        while (isalnum((unsigned char)s[i]) || s[i] == '_')
+            i++;
+        char numBuf[32];
+        const char *value = getVar(s + start, i - start, numBuf);
+        result = value ? strtoll(value, nullptr, 10) : 0;
+    } else {
+        bool negative = false;
+        if (s[i] == '-') {
+            negative = true;
+            i++;
+        }
+        long long num = 0;
+        bool valid = false;
+        while (isdigit((unsigned char)s[i])) {
+            valid = true;
+            num = num * 10 + (s[i] - '0');
+            i++;
+        }
+        if (!valid)
+            return arithError("invalid token");
+        result = negative ? -num : num;
+    }
+    return result;
+}
+
+long long evaluateArithmetic(const char *expr) {
+    size_t i = 0;
+    long long result = parseExpression(expr, i);
+    return result;
+}
+
+// ===================== Variables & Expansion =====================
+
+// Special parameters ($?, $$, $#, $0, $1..) aur shell/env variables.
+// Chhote numbers numBuf (32 bytes) mein format hote hain.
+const char *getVar(const char *name, size_t len, char *numBuf) {
+    if (len == 0)
+        return nullptr;
+    if (len == 1 && !isNameStart(*name)) {
+        switch (*name) {
+        case '?': snprintf(numBuf, 32, "%d", lastStatus); return numBuf;
+        case '$': snprintf(numBuf, 32, "%d", (int)getpid()); return numBuf;
+        case '#': snprintf(numBuf, 32, "%d", positionalCount); return numBuf;
+        case '0': return scriptName;
+        default: break;
+        }
+    }
+    if (isdigit((unsigned char)*name)) {
+        int idx = atoi(name);
+        return (idx >= 1 && idx <= positionalCount) ? positionalArgs[idx - 1] : nullptr;
+    }
+    string key(name, len);      // SSO: chhote naam allocate nahi karte
+    auto it = shellVars.find(key);
+    if (it != shellVars.end())
+        return it->second.c_str();
+    return getenv(key.c_str());
+}
+
+// Exported variable (environment mein hai) ho to env bhi update karo
+void setVar(const char *name, const char *value) {
+    shellVars[name] = value;
+    if (getenv(name))
+        setenv(name, value, 1);
+}
+
+// Word ko fields mein expand karta hai. Sirf unquoted expansions par
+// whitespace field splitting hoti hai; quotes ke andar value ek hi field hai.
+void expandWord(const Word *w, TokenList &out, bool split) {
+    ArenaString cur;
+    bool have = w->hasQuotes;
+    char numBuf[32];
+    ArenaString captured;
+    for (const WordPart *p = w->parts; p; p = p->next) {
+        if (p->kind == WP_LITERAL) {
+            cur.append(p->text, p->len);
+            have = true;
+            continue;
+        }
+        const char *value;
+        if (p->kind == WP_COMMAND && (p->quoted || !split)) {
+            // Quoted: output seedha current field mein, koi extra copy nahi
+            captureCommand(p->program, cur);
+            have = true;
+            continue;
+        } else if (p->kind == WP_COMMAND) {
+            captured.clear();
+            captureCommand(p->program, captured);
+            value = captured.c_str();
+        } else if (p->kind == WP_ARITH) {
+            snprintf(numBuf, sizeof(numBuf), "%lld", evaluateArithmetic(p->text));
+            value = numBuf;
+        } else if (p->len == 1 && (p->text[0] == '@' || p->text[0] == '*')) {
+            // "$@": har positional argument alag field
+            bool separate = split && (p->text[0] == '@' || !p->quoted);
+            for (int i = 0; i < positionalCount; i++) {
+                if (i > 0 && separate) {
+                    out.push_back(move(cur));
+                    cur.clear();
+                } else if (i > 0) {
+                    cur.push_back(' ');
+                }
+                cur.append(positionalArgs[i]);
+                have = true;
+            }
+            continue;
+        } else {
+            value = getVar(p->text, p->len, numBuf);
+            if (!value)
+                value = "";
+        }
+        if (p->quoted || !split) {
+            cur.append(value);
+            have = true;
+            continue;
+        }
+        for (const char *c = value; *c; c++) {
+            if (*c == ' ' || *c == '\t' || *c == '\n') {
+                if (have) {
+                    out.push_back(move(cur));
+                    cur.clear();
+                    have = false;
+                }
+            } else {
+                cur.push_back(*c);
+                have = true;
+            }
+        }
+    }
+    if (have)
+        out.push_back(move(cur));
+}
+
+ArenaString expandWordString(const Word *w) {
+    TokenList fields;
+    expandWord(w, fields, false);
+    return fields.empty() ? ArenaString() : move(fields[0]);
+}
+
+// Pichhle expansion mein $((...)) error hua? (flag reset ho jata hai)
+static bool takeExpansionError() {
+    bool failed = expansionFailed;
+    expansionFailed = false;
+    return failed;
+}
+
+// ===================== I/O Redirection Helper =====================
+
+static void flushOutput() {
+    cout.flush();
+    cerr.flush();
+    fflush(nullptr);
+}
+
+// Redirection ka source fd: file kholo, ya R_DUP ke liye target fd number
+static int redirSourceFd(const Redir *r, bool &owned) {
+    ArenaString target = expandWordString(r->target);
+    owned = false;
+    if (takeExpansionError())
+        return -1;
+    if (r->kind == R_DUP) {
+        if (target.empty() || target.find_first_not_of("0123456789") != ArenaString::npos) {
+            cerr << "ishell: " << target << ": bad file descriptor\n";
+            return -1;
+        }
+        return atoi(target.c_str());
+    }
+    int fd;
+    if (r->kind == R_IN) {
+        fd = open(target.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0)
+            perror("open input");
+    } else {
+        int mode = (r->kind == R_APPEND) ? O_APPEND : O_TRUNC;
+        fd = open(target.c_str(), O_WRONLY | O_CREAT | mode | O_CLOEXEC, 0644);
+        if (fd < 0)
+            perror("open output");
+    }
+    owned = fd >= 0;
+    return fd;
+}
+
+// Child process mein (exec se pehle) redirections lagao
+static bool applyRedirections(const Redir *redirs) {
+    for (const Redir *r = redirs; r; r = r->next) {
+        bool owned;
+        int src = redirSourceFd(r, owned);
+        if (src < 0)
+            return false;
+        if (src != r->fd && dup2(src, r->fd) == -1) {
+            perror("dup2");
+            return false;
+        }
+        if (owned && src != r->fd)
+            close(src);
+    }
+    return true;
+}
+
+// Built-ins aur compound commands shell process mein chalte hain: affected
+// fds save karke redirect karo, scope khatam hone par restore.
+class RedirectionGuard {
+public:
+    explicit RedirectionGuard(const Redir *redirs);
+    ~RedirectionGuard();
+    bool ok() const { return success; }
+private:
+    struct Saved {
+        int fd;
+        int copy;       // -1: fd pehle band tha
+    };
+    Saved *saved;       // currentArena se, Redir chain jitna bada
+    int count;
+    bool success;
+    RedirectionGuard(const RedirectionGuard &) = delete;
+    RedirectionGuard &operator=(const RedirectionGuard &) = delete;
+};
+
+RedirectionGuard::RedirectionGuard(const Redir *redirs) : saved(nullptr), count(0), success(true) {
+    if (!redirs)
+        return;
+    size_t total = 0;
+    for (const Redir *r = redirs; r; r = r->next)
+        total++;
+    saved = static_cast<Saved*>(currentArena->allocate(total * sizeof(Saved), alignof(Saved)));
+    flushOutput();
+    for (const Redir *r = redirs; r; r = r->next) {
+        bool owned;
+        int src = redirSourceFd(r, owned);
+        if (src < 0) {
+            success = false;
+            break;
+        }
+        saved[count].fd = r->fd;
+        saved[count].copy = fcntl(r->fd, F_DUPFD_CLOEXEC, 10);
+        count++;
+        if (src != r->fd)
+            dup2(src, r->fd);
+        if (owned && src != r->fd)
+            close(src);
+    }
+}
+
+RedirectionGuard::~RedirectionGuard() {
+    if (count == 0)
+        return;
+    flushOutput();
+    for (int i = count - 1; i >= 0; i--) {
+        if (saved[i].copy >= 0) {
+            dup2(saved[i].copy, saved[i].fd);
+            close(saved[i].copy);
+        } else {
+            close(saved[i].fd);
+        }
+    }
+}
+
+// ===================== Launch Options (run) =====================
+
+// run [--cpus LIST] [--nice N] [--ionice CLASS[:LEVEL]] [--sched POLICY[:PRIO]] cmd args...
+// Settings launchOptions mein rehte hain aur shell ke har forked child mein exec se
+// pehle lagte hain (applyLaunchInChild). Affinity, nice, ioprio aur policy fork/exec
+// par inherit hote hain, isliye pipeline ya function ke andar sab kuch unhi ke saath
+// chalta hai. Shell process khud kabhi nahi badalta.
+
+const int IOPRIO_CLASS_SHIFT = 13;
+const int IOPRIO_CLASS_RT = 1;
+const int IOPRIO_CLASS_BE = 2;
+const int IOPRIO_CLASS_IDLE = 3;
+const int IOPRIO_WHO_PROCESS = 1;
+
+struct LaunchOptions {
+    bool active;
+    bool hasCpus;
+    cpu_set_t cpus;
+    bool hasNice;
+    int nice;
+    int ioprio;             // ioprio_set value, -1 = nahi
+    int policy;             // SCHED_*, -1 = nahi
+    int schedPriority;      // sirf fifo/rr ke liye
+};
+
+// "2-5", "0,2,4-7" -> cpu set; galat ho to false
+static bool parseCpuList(const char *s, cpu_set_t &set) {
+    CPU_ZERO(&set);
+    while (*s) {
+        char *end;
+        long first = strtol(s, &end, 10);
+        long last = first;
+        if (end == s || first < 0)
+            return false;
+        if (*end == '-') {
+            s = end + 1;
+            last = strtol(s, &end, 10);
+            if (end == s || last < first)
+                return false;
+        }
+        if (last >= CPU_SETSIZE)
+            return false;
+        for (long cpu = first; cpu <= last; cpu++)
+            CPU_SET(cpu, &set);
+        if (*end == ',' && end[1] != '\0')
+            end++;
+        else if (*end != '\0')
+            return false;
+        s = end;
+    }
+    return CPU_COUNT(&set) > 0;
+}
+
+// "name" ya "name:N"; N na ho to def. Naam match na ho to false
+static bool parseNamedLevel(const char *s, const char *name, int def, int &level) {
+    size_t len = strlen(name);
+    if (strncmp(s, name, len) != 0 || (s[len] != '\0' && s[len] != ':'))
+        return false;
+    level = def;
+    if (s[len] == ':') {
+        char *end;
+        level = (int)strtol(s + len + 1, &end, 10);
+        if (end == s + len + 1 || *end != '\0')
+            level = -1;
+    }
+    return true;
+}
+
+// idle / best-effort[:0-7] / realtime[:0-7] -> ioprio value; galat ho to -1
+static int parseIoClass(const char *s) {
+    int level;
+    if (strcmp(s, "idle") == 0)
+        return IOPRIO_CLASS_IDLE << IOPRIO_CLASS_SHIFT;
+    if (parseNamedLevel(s, "best-effort", 4, level) || parseNamedLevel(s, "be", 4, level))
+        return (level >= 0 && level <= 7) ? (IOPRIO_CLASS_BE << IOPRIO_CLASS_SHIFT) | level : -1;
+    if (parseNamedLevel(s, "realtime", 4, level) || parseNamedLevel(s, "rt", 4, level))
+        return (level >= 0 && level <= 7) ? (IOPRIO_CLASS_RT << IOPRIO_CLASS_SHIFT) | level : -1;
+    return -1;
+}
+
+// other / batch / idle / fifo[:PRIO] / rr[:PRIO]; galat ho to false
+static bool parseSchedPolicy(const char *s, int &policy, int &priority) {
+    priority = 0;
+    if (strcmp(s, "other") == 0 || strcmp(s, "normal") == 0)
+        policy = SCHED_OTHER;
+    else if (strcmp(s, "batch") == 0)
+        policy = SCHED_BATCH;
+    else if (strcmp(s, "idle") == 0)
+        policy = SCHED_IDLE;
+    else if (parseNamedLevel(s, "fifo", 1, priority))
+        policy = SCHED_FIFO;
+    else if (parseNamedLevel(s, "rr", 1, priority))
+        policy = SCHED_RR;
+    else
+        return false;
+    return priority >= sched_get_priority_min(policy) && priority <= sched_get_priority_max(policy);
+}
+
+// tokens[0] = "run"; options opts mein (jo nahi diye woh pehle jaise). Command ka
+// index return, usage error par 0
+static size_t parseLaunchOptions(const TokenList &tokens, LaunchOptions &opts) {
+    size_t i = 1;
+    for (; i < tokens.size() && tokens[i].compare(0, 2, "--") == 0; i++) {
+        const ArenaString &opt = tokens[i];
+        if (opt == "--") {
+            i++;
+            break;
+        }
+        if (i + 1 >= tokens.size()) {
+            cerr << "run: " << opt << ": missing value\n";
+            return 0;
+        }
+        const char *value = tokens[++i].c_str();
+        char *end;
+        bool ok = true;
+        if (opt == "--cpus") {
+            ok = parseCpuList(value, opts.cpus);
+            opts.hasCpus = true;
+        } else if (opt == "--nice") {
+            long nice = strtol(value, &end, 10);
+            ok = end != value && *end == '\0' && nice >= -20 && nice <= 19;
+            opts.hasNice = true;
+            opts.nice = (int)nice;
+        } else if (opt == "--ionice") {
+            opts.ioprio = parseIoClass(value);
+            ok = opts.ioprio >= 0;
+        } else if (opt == "--sched") {
+            ok = parseSchedPolicy(value, opts.policy, opts.schedPriority);
+        } else {
+            ok = false;
+        }
+        if (!ok) {
+            cerr << "run: invalid option " << opt << " " << value << "\n";
+            return 0;
+        }
+    }
+    if (i >= tokens.size()) {
+        cerr << "Usage: run [--cpus LIST] [--nice N] [--ionice CLASS[:LEVEL]] "
+                "[--sched POLICY[:PRIO]] command [args...]\n";
+        return 0;
+    }
+    opts.active = true;
+    return i;
+}
+
+static LaunchOptions noLaunchOptions() {
+    LaunchOptions opts;
+    memset(&opts, 0, sizeof(opts));
+    opts.ioprio = -1;
+    opts.policy = -1;
+    return opts;
+}
+
+LaunchOptions launchOptions = noLaunchOptions();   // chal rahe 'run' ke settings
+
+static void launchFailed(const char *what) {
+    perror(what);
+    _exit(126);
+}
+
+// Fork ke baad child mein. Koi setting na lag sake to command nahi chalta (126):
+// pinned/low-priority maan kar chalaya gaya job bina limits ke na chale.
+void applyLaunchInChild() {
+    const LaunchOptions &opts = launchOptions;
+    if (!opts.active)
+        return;
+    if (opts.hasCpus && sched_setaffinity(0, sizeof(opts.cpus), &opts.cpus) != 0)
+        launchFailed("run: sched_setaffinity");
+    if (opts.policy >= 0) {
+        struct sched_param param;
+        memset(&param, 0, sizeof(param));
+        param.sched_priority = opts.schedPriority;
+        if (sched_setscheduler(0, opts.policy, &param) != 0)
+            launchFailed("run: sched_setscheduler");
+    }
+    // Policy ke baad, taaki batch/other par bhi nice wahi rahe jo manga
+    if (opts.hasNice && setpriority(PRIO_PROCESS, 0, opts.nice) != 0)
+        launchFailed("run: setpriority");
+#ifdef SYS_ioprio_set
+    if (opts.ioprio >= 0 && syscall(SYS_ioprio_set, IOPRIO_WHO_PROCESS, 0, opts.ioprio) != 0)
+        launchFailed("run: ioprio_set");
+#endif
+}
+
+// 'run OPTS cmd | ...' wala pehla stage: options poori pipeline par lagte hain.
+// Alias ya function 'run' ho to yeh builtin nahi hai.
+static bool isRunStage(const Node *stage) {
+    const Word *w = stage->words;
+    return stage->kind == N_SIMPLE && w && w->plain && w->rawLen == 3 &&
+           memcmp(w->raw, "run", 3) == 0 && !aliases.count("run") && !functions.count("run");
+}
+
+int handleRun(const TokenList &tokens) {
+    LaunchOptions opts = launchOptions;     // nested 'run' sirf diye gaye settings badalta hai
+    size_t start = parseLaunchOptions(tokens, opts);
+    if (start == 0)
+        return 2;
+    TokenList command(tokens.begin() + start, tokens.end());
+    LaunchOptions saved = launchOptions;
+    launchOptions = opts;
+    static Node bare;       // run ke apne assigns/redirections pehle hi lag chuke
+    int status = execTokens(command, &bare, false);
+    launchOptions = saved;
+    return status;
+}
+
+// ===================== External Command Execution =====================
+
+// Foreground wait ke dauran SIGCHLD block rehta hai, warna sigchldHandler
+// hamara child pehle reap kar leta hai aur exit status kho jata hai.
+class ChildSignalBlock {
+public:
+    ChildSignalBlock() {
+        sigset_t set;
+        sigemptyset(&set);
+        sigaddset(&set, SIGCHLD);
+        sigprocmask(SIG_BLOCK, &set, &old);
+    }
+    ~ChildSignalBlock() { sigprocmask(SIG_SETMASK, &old, nullptr); }
+    void restoreInChild() const { sigprocmask(SIG_SETMASK, &old, nullptr); }
+private:
+    sigset_t old;
+};
+
+static int statusFromWait(int status) {
+    if (WIFEXITED(status))
+        return WEXITSTATUS(status);
+    if (WIFSIGNALED(status)) {
+        if (WTERMSIG(status) == SIGINT)
+            interruptRequested = 1;     // Ctrl-C: baaki list/loop mat chalao
+        return 128 + WTERMSIG(status);
+    }
+    if (WIFSTOPPED(status))
+        return 128 + WSTOPSIG(status);
+    return 0;
+}
+
+static int waitForeground(pid_t pid) {
+    fg_pid = pid;
+    int status = 0;
+    while (waitpid(pid, &status, WUNTRACED) < 0 && errno == EINTR) {}
+    fg_pid = 0;
+    return statusFromWait(status);
+}
+
+// Child mein: prefix assignments env mein, redirections, phir exec
+static void execChild(const char *path, char **args, const Word *assigns, const Redir *redirs) {
+    for (const Word *a = assigns; a; a = a->next) {
+        ArenaString value = expandWordString(a);
+        if (takeExpansionError())
+            _exit(EXIT_FAILURE);
+        setenv(a->assignName, value.c_str(), 1);
+    }
+    if (!applyRedirections(redirs))
+        _exit(EXIT_FAILURE);
+    execv(path, args);
+    perror("execv");
+    _exit(126);
+}
+
+// execDirect: hum pehle se forked child (pipeline stage / background) mein
+// hain, to dobara fork kiye bina seedha exec karo.
+int executeExternalCommand(TokenList &tokens, Word *assigns, Redir *redirs, bool execDirect) {
+    ArenaString fullPath = findExecutablePath(tokens[0].c_str());
+    if (fullPath.empty()) {
+        cerr << "ishell: " << tokens[0] << ": command not found\n";
+        return 127;
+    }
+    ArgVector args;
+    args.reserve(tokens.size() + 1);
+    for (size_t i = 0; i < tokens.size(); i++)
+        args.push_back(const_cast<char*>(tokens[i].c_str()));
+    args.push_back(nullptr);
+    args[0] = const_cast<char*>(fullPath.c_str());
+
+    if (execDirect)
+        execChild(fullPath.c_str(), args.data(), assigns, redirs);
+
+    ChildSignalBlock block;
+    flushOutput();
+    pid_t pid = fork();
+    if (pid == 0) {
+        block.restoreInChild();
+        applyLaunchInChild();
+        execChild(fullPath.c_str(), args.data(), assigns, redirs);
+    } else if (pid < 0) {
+        perror("fork");
+        return 1;
+    }
+    return waitForeground(pid);
+}
+
+// ===================== Pipeline Execution =====================
+
+// Har stage ek forked child hai; stage poora node hai (builtin, function ya
+// compound bhi ho sakta hai). Status aakhri stage ka hota hai.
+// 'run OPTS cmd | ...': pehle stage ke words parent mein ek baar expand hote hain
+// aur options har stage ke child par lagte hain.
+int execPipeline(Node *n) {
+    int status = 0;
+    TokenList runTokens;
+    size_t runStart = 0;
+    LaunchOptions savedLaunch = launchOptions;
+    if (n->cond->next && isRunStage(n->cond)) {
+        for (const Word *w = n->cond->words; w; w = w->next)
+            expandWord(w, runTokens);
+        runStart = parseLaunchOptions(runTokens, launchOptions);
+        if (runStart == 0) {
+            launchOptions = savedLaunch;
+            return 2;
+        }
+    }
+    if (n->cond->next == nullptr) {
+        status = execNode(n->cond, false);
+    } else {
+        ChildSignalBlock block;
+        flushOutput();
+        vector<pid_t, ArenaAllocator<pid_t>> pids;
+        int prevRead = -1;
+        for (Node *stage = n->cond; stage; stage = stage->next) {
+            int pipefds[2] = {-1, -1};
+            if (stage->next && pipe(pipefds) < 0) {
+                perror("pipe");
+                break;
+            }
+            pid_t pid = fork();
+            if (pid == 0) {
+                block.restoreInChild();
+                applyLaunchInChild();
+                if (prevRead != -1) {
+                    if (dup2(prevRead, STDIN_FILENO) == -1) {
+                        perror("dup2 pipe input");
+                        _exit(EXIT_FAILURE);
+                    }
+                    close(prevRead);
+                }
+                if (pipefds[1] != -1) {
+                    if (dup2(pipefds[1], STDOUT_FILENO) == -1) {
+                        perror("dup2 pipe output");
+                        _exit(EXIT_FAILURE);
+                    }
+                    close(pipefds[0]);
+                    close(pipefds[1]);
+                }
+                int stageStatus;
+                if (runStart && stage == n->cond) {
+                    TokenList command(runTokens.begin() + runStart, runTokens.end());
+                    stageStatus = execTokens(command, stage, true);
+                } else {
+                    stageStatus = execNode(stage, true);
+                }
+                flushOutput();
+                _exit(stageStatus);
+            } else if (pid < 0) {
+                perror("fork");
+                if (pipefds[0] != -1) {
+                    close(pipefds[0]);
+                    close(pipefds[1]);
+                }
+                break;
+            }
+            pids.push_back(pid);
+            if (prevRead != -1)
+                close(prevRead);
+            if (pipefds[1] != -1)
+                close(pipefds[1]);
+            prevRead = pipefds[0];
+        }
+        if (prevRead != -1)
+            close(prevRead);
+        for (pid_t pid : pids)
+            status = waitForeground(pid);
+    }
+    launchOptions = savedLaunch;
+    if (n->negate)
+        status = (status == 0) ? 1 : 0;
+    return status;
+}
+
+// ===================== Resource Limits (limit) =====================
+
+// limit [--timeout T] [--mem SIZE] [--cpu T] cmd args...
+// Command apne process group mein chalta hai. --mem / --cpu child mein exec se
+// pehle setrlimit; --timeout shell ke wait loop mein timerfd + pidfd se: deadline
+// par group ko SIGTERM, LIMIT_KILL_GRACE baad bhi zinda ho to SIGKILL.
+
+const double LIMIT_KILL_GRACE = 2.0;    // SIGTERM ke baad SIGKILL tak (seconds)
+
+struct CommandLimits {
+    double timeout;             // seconds, 0 = nahi
+    rlim_t mem;                 // bytes (RLIMIT_AS), 0 = nahi
+    rlim_t cpu;                 // seconds (RLIMIT_CPU), 0 = nahi
+    const char *timeoutText, *memText, *cpuText;    // messages ke liye jaisa likha tha
+};
+
+// "1.5", "500ms", "30s", "2m", "1h" -> seconds; galat ho to -1
+static double parseDuration(const char *s) {
+    char *end;
+    errno = 0;
+    double v = strtod(s, &end);
+    if (errno != 0 || end == s || v < 0)
+        return -1;
+    if (strcmp(end, "ms") == 0)
+        v /= 1000;
+    else if (strcmp(end, "m") == 0)
+        v *= 60;
+    else if (strcmp(end, "h") == 0)
+        v *= 3600;
+    else if (*end != '\0' && strcmp(end, "s") != 0)
+        return -1;
+    return v;
+}
+
+// "4096", "64K", "512M", "1G" (1024 ke multiples) -> bytes; galat ho to 0
+static rlim_t parseSize(const char *s) {
+    char *end;
+    errno = 0;
+    double v = strtod(s, &end);
+    if (errno != 0 || end == s || v <= 0)
+        return 0;
+    const char *units = "KMGT";
+    const char *u = (*end != '\0') ? strchr(units, toupper((unsigned char)*end)) : nullptr;
+    if (u) {
+        for (const char *p = units; p <= u; p++)
+            v *= 1024;
+        end++;
+        if (*end == 'B' || *end == 'b')
+            end++;
+    }
+    return *end == '\0' ? (rlim_t)v : 0;
+}
+
+static void armTimer(int timerFd, double seconds) {
+    struct itimerspec its;
+    memset(&its, 0, sizeof(its));
+    its.it_value.tv_sec = (time_t)seconds;
+    its.it_value.tv_nsec = (long)((seconds - (double)its.it_value.tv_sec) * 1e9);
+    if (its.it_value.tv_sec == 0 && its.it_value.tv_nsec == 0)
+        its.it_value.tv_nsec = 1;       // 0 ka matlab timer band hota
+    timerfd_settime(timerFd, 0, &its, nullptr);
+}
+
+// Child (group leader) ka wait: pidfd exit par readable, timerfd deadline par.
+// pidfd na mile to 50ms poll + WNOHANG. killed: 0 = nahi, 1 = SIGTERM, 2 = SIGKILL
+static int waitLimited(pid_t pid, const CommandLimits &limits, int &killed, struct rusage &usage) {
+    killed = 0;
+    int timerFd = -1, pidFd = -1;
+    if (limits.timeout > 0) {
+        timerFd = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC);
+        if (timerFd < 0)
+            perror("timerfd_create");
+        else
+            armTimer(timerFd, limits.timeout);
+    }
+#ifdef SYS_pidfd_open
+    pidFd = (int)syscall(SYS_pidfd_open, pid, 0);
+#endif
+    fg_pid = pid;
+    int status = 0;
+    while (true) {
+        struct pollfd fds[2];
+        fds[0].fd = pidFd;
+        fds[1].fd = timerFd;
+        fds[0].events = fds[1].events = POLLIN;
+        fds[0].revents = fds[1].revents = 0;
+        int rc = poll(fds, 2, pidFd >= 0 ? -1 : 50);
+        if (rc < 0 && errno != EINTR)
+            break;
+        if (rc > 0 && fds[1].revents) {
+            uint64_t expirations;
+            if (read(timerFd, &expirations, sizeof(expirations)) < 0) {}
+            if (killed == 0) {
+                kill(-pid, SIGTERM);
+                kill(-pid, SIGCONT);    // stopped process SIGTERM tabhi dekhta hai
+                armTimer(timerFd, LIMIT_KILL_GRACE);
+                killed = 1;
+            } else if (killed == 1) {
+                kill(-pid, SIGKILL);
+                killed = 2;
+            }
+        }
+        if (pidFd >= 0 && !(rc > 0 && fds[0].revents))
+            continue;
+        // Leader reap karne se pehle bache hue group members saaf (pgid abhi valid hai)
+        if (killed && pidFd >= 0)
+            kill(-pid, SIGKILL);
+        pid_t r = wait4(pid, &status, pidFd >= 0 ? 0 : WNOHANG, &usage);
+        if (r == pid || (r < 0 && errno != EINTR))
+            break;
+    }
+    fg_pid = 0;
+    for (int fd : {timerFd, pidFd}) {
+        if (fd >= 0)
+            close(fd);
+    }
+    return status;
+}
+
+int handleLimit(const TokenList &tokens) {
+    CommandLimits limits;
+    memset(&limits, 0, sizeof(limits));
+    size_t i = 1;
+    for (; i < tokens.size() && tokens[i].compare(0, 2, "--") == 0; i++) {
+        const ArenaString &opt = tokens[i];
+        if (opt == "--") {
             i++;
+            break;
+        }
+        if (i + 1 >= tokens.size()) {
+            cerr << "limit: " << opt << ": missing value\n";
+            return 2;
+        }
+        const char *value = tokens[++i].c_str();
+        if (opt == "--timeout" && parseDuration(value) > 0) {
+            limits.timeout = parseDuration(value);
+            limits.timeoutText = value;
+        } else if (opt == "--cpu" && parseDuration(value) >= 1) {
+            limits.cpu = (rlim_t)parseDuration(value);
+            limits.cpuText = value;
+        } else if (opt == "--mem" && parseSize(value) > 0) {
+            limits.mem = parseSize(value);
+            limits.memText = value;
+        } else {
+            cerr << "limit: invalid option " << opt << " " << value << "\n";
+            return 2;
+        }
+    }
+    if (i >= tokens.size()) {
+        cerr << "Usage: limit [--timeout T] [--mem SIZE] [--cpu T] command [args...]\n";
+        return 2;
+    }
+    TokenList command(tokens.begin() + i, tokens.end());
+
+    // Terminal ho to naya group foreground mein (warna tty read par SIGTTIN)
+    bool giveTerminal = isatty(STDIN_FILENO) && tcgetpgrp(STDIN_FILENO) == getpgrp();
+    ChildSignalBlock block;
+    flushOutput();
+    pid_t pid = fork();
+    if (pid == 0) {
+        block.restoreInChild();
+        applyLaunchInChild();
+        setpgid(0, 0);
+        if (giveTerminal) {
+            signal(SIGTTOU, SIG_IGN);
+            tcsetpgrp(STDIN_FILENO, getpid());
+            signal(SIGTTOU, SIG_DFL);
+            // Deadline chal rahi hai: Ctrl-Z se suspend nahi (shell pidfd par exit ka wait karta hai)
+            signal(SIGTSTP, SIG_IGN);
+        }
+        struct rlimit rl;
+        if (limits.mem) {
+            rl.rlim_cur = rl.rlim_max = limits.mem;
+            if (setrlimit(RLIMIT_AS, &rl) != 0)
+                perror("limit: setrlimit(RLIMIT_AS)");
+        }
+        if (limits.cpu) {
+            // Soft limit par SIGXCPU, ek second baad hard limit par SIGKILL
+            rl.rlim_cur = limits.cpu;
+            rl.rlim_max = limits.cpu + 1;
+            if (setrlimit(RLIMIT_CPU, &rl) != 0)
+                perror("limit: setrlimit(RLIMIT_CPU)");
+        }
+        static Node bare;       // limit ke apne assigns/redirections pehle hi lag chuke
+        int status = execTokens(command, &bare, true);
+        flushOutput();
+        _exit(status);
+    } else if (pid < 0) {
+        perror("fork");
+        return 1;
+    }
+    setpgid(pid, pid);
+    if (giveTerminal)
+        tcsetpgrp(STDIN_FILENO, pid);
+    int killed;
+    struct rusage usage;
+    memset(&usage, 0, sizeof(usage));
+    int raw = waitLimited(pid, limits, killed, usage);
+    if (giveTerminal) {
+        void (*old)(int) = signal(SIGTTOU, SIG_IGN);
+        tcsetpgrp(STDIN_FILENO, getpgrp());
+        signal(SIGTTOU, old);
+    }
+
+    // Kaunsi limit lagi, batao
+    int status = statusFromWait(raw);
+    int sig = WIFSIGNALED(raw) ? WTERMSIG(raw) : 0;
+    double cpuUsed = usage.ru_utime.tv_sec + usage.ru_stime.tv_sec +
+                     (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1e6;
+    const char *name = command[0].c_str();
+    if (killed) {
+        cerr << "ishell: limit: " << name << ": timed out after " << limits.timeoutText
+             << (killed == 2 ? " (killed with SIGKILL)" : "") << "\n";
+        return 124;
+    }
+    if (limits.cpu && (sig == SIGXCPU || (sig == SIGKILL && cpuUsed >= (double)limits.cpu))) {
+        cerr << "ishell: limit: " << name << ": CPU time limit (" << limits.cpuText << ") exceeded\n";
+    } else if (limits.mem && status != 0 && sig != SIGINT) {
+        // RLIMIT_AS par sirf allocation fail hoti hai (kernel na signal bhejta, na
+        // ginta): program crash ho ya error se nikle, dono mein limit ka zikr karo
+        cerr << "ishell: limit: " << name << ": ";
+        if (sig)
+            cerr << "terminated by " << strsignal(sig);
+        else
+            cerr << "exited with status " << status;
+        cerr << " (memory limit " << limits.memText << " may have been reached)\n";
+    }
+    return status;
+}
+
+// ===================== Command Substitution =====================
+
+// cout ka output seedha destination ArenaString mein (in-process $(builtin))
+class CaptureBuf : public streambuf {
+public:
+    explicit CaptureBuf(ArenaString &out) : out(out) {}
+protected:
+    int_type overflow(int_type c) override {
+        if (!traits_type::eq_int_type(c, traits_type::eof()))
+            out.push_back(traits_type::to_char_type(c));
+        return traits_type::not_eof(c);
+    }
+    streamsize xsputn(const char *s, streamsize n) override {
+        out.append(s, (size_t)n);
+        return n;
+    }
+private:
+    ArenaString &out;
+};
+
+// $(pwd), $(echo ...), $(history): BI_PIPELINE builtins bina fork ke.
+// Command name statically check hota hai taaki fallback par words do baar expand na hon.
+static bool captureBuiltin(Node *program, ArenaString &out, int &status) {
+    if (program->next || program->kind != N_SIMPLE || program->background ||
+        program->negate || program->assigns || program->redirs)
+        return false;
+    const Word *w = program->words;
+    if (!w || !w->plain)
+        return false;
+    string name(w->raw, w->rawLen);
+    const BuiltinDesc *b = findBuiltin(name.c_str());
+    if (!b || !(b->flags & BI_PIPELINE) || aliases.count(name) || functions.count(name))
+        return false;
+    TokenList tokens;
+    for (; w; w = w->next)
+        expandWord(w, tokens);
+    flushOutput();
+    CaptureBuf buf(out);
+    streambuf *saved = cout.rdbuf(&buf);
+    status = b->handler(tokens);
+    cout.rdbuf(saved);
+    return true;
+}
+
+// Pipe ko EOF tak out ke end mein padho. size == capacity rakha jata hai taaki
+// read seedha string ke buffer mein ho; growth geometric hai (quadratic copy nahi).
+static void readAllInto(int fd, ArenaString &out) {
+    const size_t CHUNK = 64 * 1024;
+    size_t len = out.size();
+    while (true) {
+        if (out.size() - len < CHUNK)
+            out.resize(max(out.size() * 2, len + CHUNK));
+        ssize_t n = read(fd, &out[len], out.size() - len);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            break;
+        len += (size_t)n;
+    }
+    out.resize(len);
+}
+
+// Subshell child ka stdout memfd par: exit ke baad size pata hai, to destination
+// ek hi baar resize hokar ek pread mein bhar jata hai. memfd na mile to pipe.
+static int captureForked(Node *program, ArenaString &out) {
+    int memFd = memfd_create("ishell-subst", MFD_CLOEXEC);
+    int pipeFds[2] = {-1, -1};
+    if (memFd < 0 && pipe2(pipeFds, O_CLOEXEC) < 0) {
+        perror("pipe");
+        return 1;
+    }
+    ChildSignalBlock block;
+    flushOutput();
+    pid_t pid = fork();
+    if (pid == 0) {
+        block.restoreInChild();
+        applyLaunchInChild();
+        dup2(memFd >= 0 ? memFd : pipeFds[1], STDOUT_FILENO);
+        int status = execList(program);
+        flushOutput();
+        _exit(status);
+    }
+    if (pid < 0) {
+        perror("fork");
+        for (int fd : {memFd, pipeFds[0], pipeFds[1]}) {
+            if (fd >= 0)
+                close(fd);
+        }
+        return 1;
+    }
+    if (memFd < 0) {
+        close(pipeFds[1]);
+        readAllInto(pipeFds[0], out);
+        close(pipeFds[0]);
+        return waitForeground(pid);
+    }
+    int status = waitForeground(pid);
+    struct stat st;
+    if (fstat(memFd, &st) == 0 && st.st_size > 0) {
+        size_t base = out.size(), size = (size_t)st.st_size, got = 0;
+        out.resize(base + size);
+        while (got < size) {
+            ssize_t n = pread(memFd, &out[base + got], size - got, got);
+            if (n < 0 && errno == EINTR)
+                continue;
+            if (n <= 0)
+                break;
+            got += (size_t)n;
+        }
+        out.resize(base + got);
+    }
+    close(memFd);
+    return status;
+}
+
+// Command ka output out ke end mein append, trailing newlines hata ke.
+int captureCommand(Node *program, ArenaString &out) {
+    size_t base = out.size();
+    int status = 0;
+    if (program && !captureBuiltin(program, out, status))
+        status = captureForked(program, out);
+    while (out.size() > base && out.back() == '\n')
+        out.pop_back();
+    lastSubstStatus = status;
+    return status;
+}
+
+// ===================== Structured Output =====================
+
+// ls / search / pinfo / history ke machine-readable records. Fields seedha ek
+// arena buffer mein format hote hain (iostream per field nahi); buffer bharne
+// par ya writer khatam hone par cout par ek hi write.
+//   OUT_JSON: har record ek JSON object, ek line
+//   OUT_NUL:  har field "name=value\0", record ke end mein ek extra '\0'
+class RecordWriter {
+public:
+    explicit RecordWriter(OutputFormat format) : format(format), first(true) {
+        buf.reserve(FLUSH_BYTES + 1024);
+    }
+    ~RecordWriter() { flush(); }
+
+    void begin() {
+        if (format == OUT_JSON)
+            buf.push_back('{');
+        first = true;
+    }
+    void end() {
+        if (format == OUT_JSON)
+            buf.append("}\n", 2);
+        else
+            buf.push_back('\0');
+        if (buf.size() >= FLUSH_BYTES)
+            flush();
+    }
+    void str(const char *k, const char *s, size_t len) {
+        key(k);
+        if (format == OUT_JSON) {
+            buf.push_back('"');
+            appendEscaped(s, len);
+            buf.push_back('"');
+        } else {
+            buf.append(s, len);
+        }
+        endField();
+    }
+    void str(const char *k, const char *s) { str(k, s, strlen(s)); }
+    void num(const char *k, long long v) {
+        key(k);
+        appendInt(v);
+        endField();
+    }
+    void real(const char *k, double v) {
+        char tmp[32];
+        int n = snprintf(tmp, sizeof(tmp), "%.1f", v);
+        key(k);
+        buf.append(tmp, n);
+        endField();
+    }
+    void boolean(const char *k, bool v) {
+        key(k);
+        if (v)
+            buf.append("true", 4);
+        else
+            buf.append("false", 5);
+        endField();
+    }
+    void flush() {
+        if (!buf.empty()) {
+            cout.write(buf.data(), buf.size());
+            buf.clear();
+        }
+    }
+
+private:
+    static const size_t FLUSH_BYTES = 64 * 1024;
+    ArenaString buf;
+    OutputFormat format;
+    bool first;
+
+    void key(const char *k) {
+        if (format == OUT_JSON) {
+            if (!first)
+                buf.push_back(',');
+            buf.push_back('"');
+            buf.append(k);
+            buf.append("\":", 2);
+        } else {
+            buf.append(k);
+            buf.push_back('=');
+        }
+        first = false;
+    }
+    void endField() {
+        if (format == OUT_NUL)
+            buf.push_back('\0');
+    }
+    void appendInt(long long v) {
+        char tmp[24];
+        char *p = tmp + sizeof(tmp);
+        unsigned long long u = v < 0 ? 0ULL - (unsigned long long)v : (unsigned long long)v;
+        do {
+            *--p = (char)('0' + u % 10);
+            u /= 10;
+        } while (u);
+        if (v < 0)
+            *--p = '-';
+        buf.append(p, tmp + sizeof(tmp) - p);
+    }
+    // Quote, backslash aur control chars escape; baaki bytes ke runs ek saath copy
+    void appendEscaped(const char *s, size_t len) {
+        static const char hex[] = "0123456789abcdef";
+        size_t run = 0;
+        for (size_t i = 0; i < len; i++) {
+            unsigned char c = (unsigned char)s[i];
+            if (c >= 0x20 && c != '"' && c != '\\')
+                continue;
+            buf.append(s + run, i - run);
+            run = i + 1;
+            buf.push_back('\\');
+            switch (c) {
+            case '"': buf.push_back('"'); break;
+            case '\\': buf.push_back('\\'); break;
+            case '\n': buf.push_back('n'); break;
+            case '\t': buf.push_back('t'); break;
+            case '\r': buf.push_back('r'); break;
+            default:
+                buf.append("u00", 3);
+                buf.push_back(hex[c >> 4]);
+                buf.push_back(hex[c & 15]);
+            }
+        }
+        buf.append(s + run, len - run);
+    }
+};
+
+// --json / -0 / --text flags hata ke baaki tokens; format = global mode ya flag
+static OutputFormat takeFormatFlags(const TokenList &tokens, TokenList &rest) {
+    OutputFormat format = outputFormat;
+    rest.reserve(tokens.size());
+    for (const ArenaString &t : tokens) {
+        if (t == "--json")
+            format = OUT_JSON;
+        else if (t == "-0")
+            format = OUT_NUL;
+        else if (t == "--text")
+            format = OUT_TEXT;
+        else
+            rest.push_back(t);
+    }
+    return format;
+}
+
+// Colour sirf terminal ke liye (redirect / pipe / $(...) mein plain text)
+static bool stdoutIsTty() {
+    return isatty(STDOUT_FILENO) == 1;
+}
+
+// uid/gid -> naam, har lookup ke liye getpwuid/getgrgid dobara na chale
+static const char *userName(uid_t uid) {
+    static unordered_map<uid_t, string> cache;
+    auto it = cache.find(uid);
+    if (it == cache.end()) {
+        struct passwd *pw = getpwuid(uid);
+        it = cache.emplace(uid, pw ? pw->pw_name : "unknown").first;
+    }
+    return it->second.c_str();
+}
+
+static const char *groupName(gid_t gid) {
+    static unordered_map<gid_t, string> cache;
+    auto it = cache.find(gid);
+    if (it == cache.end()) {
+        struct group *gr = getgrgid(gid);
+        it = cache.emplace(gid, gr ? gr->gr_name : "unknown").first;
+    }
+    return it->second.c_str();
+}
+
+static const char *fileTypeName(mode_t mode) {
+    if (S_ISDIR(mode)) return "dir";
+    if (S_ISREG(mode)) return "file";
+    if (S_ISLNK(mode)) return "symlink";
+    if (S_ISFIFO(mode)) return "fifo";
+    if (S_ISSOCK(mode)) return "socket";
+    if (S_ISCHR(mode)) return "char";
+    if (S_ISBLK(mode)) return "block";
+    return "unknown";
+}
+
+// set -o json|nul / set +o json|nul / set -o (current mode)
+int handleSet(const TokenList &tokens) {
+    if (tokens.size() == 1 || (tokens.size() == 2 && tokens[1] == "-o")) {
+        cout << "json\t" << (outputFormat == OUT_JSON ? "on" : "off") << "\n"
+             << "nul\t" << (outputFormat == OUT_NUL ? "on" : "off") << "\n";
+        return 0;
+    }
+    for (size_t i = 1; i < tokens.size(); i += 2) {
+        bool enable = tokens[i] == "-o";
+        if ((!enable && tokens[i] != "+o") || i + 1 >= tokens.size()) {
+            cerr << "Usage: set -o|+o json|nul\n";
+            return 2;
+        }
+        const ArenaString &name = tokens[i + 1];
+        OutputFormat format;
+        if (name == "json")
+            format = OUT_JSON;
+        else if (name == "nul")
+            format = OUT_NUL;
         else {
-            cerr << "Missing closing parenthesis in arithmetic expression\n";
-            exit(EXIT_FAILURE);
+            cerr << "ishell: set: " << name << ": invalid option name\n";
+            return 2;
+        }
+        if (enable)
+            outputFormat = format;
+        else if (outputFormat == format)
+            outputFormat = OUT_TEXT;
+    }
+    return 0;
+}
+
+// ===================== Built-In Command Handlers =====================
+
+int handleCd(const TokenList &tokens) {
+    string target;
+    if (tokens.size() == 1)
+        target = getenv("HOME");
+    else if (tokens.size() == 2) {
+        target = tokens[1].c_str();
+        if (target == "~")
+            target = getenv("HOME");
+        if (target == "-") {
+            if (prevDirectory.empty()) {
+                cerr << "No previous directory\n";
+                return 1;
+            }
+            target = prevDirectory;
+        }
+    } else {
+        cerr << "Invalid arguments for cd\n";
+        return 1;
+    }
+    char *curr = getcwd(nullptr, 0);
+    int status = 0;
+    if (chdir(target.c_str()) != 0) {
+        perror("cd");
+        status = 1;
+    } else {
+        prevDirectory = string(curr);
+    }
+    if (curr)
+        free(curr);
+    return status;
+}
+
+int handlePwd(const TokenList &tokens) {
+    (void)tokens; 
+    char cwd[PATH_MAX];
+    if (getcwd(cwd, sizeof(cwd)) == nullptr) {
+        perror("pwd");
+        return 1;
+    }
+    cout << cwd << "\n";
+    return 0;
+}
+
+// $((expr)) word expansion mein hi evaluate ho jata hai
+int handleEcho(const TokenList &tokens) {
+    for (size_t i = 1; i < tokens.size(); i++) {
+        cout << tokens[i];
+        if (i < tokens.size() - 1)
+            cout << " ";
+    }
+    cout << "\n";
+    return 0;
+}
+
+// ls ki ek entry; stat ek hi baar hota hai (sort, -l aur records sab isi se)
+struct LsEntry {
+    string name;
+    bool isDir;
+    bool statOk;
+    struct stat sb;
+};
+
+int handleLs(const TokenList &args) {
+    TokenList tokens;
+    OutputFormat format = takeFormatFlags(args, tokens);
+    bool flag_a = false, flag_l = false;
+    vector<string> dirs;
+    for (size_t i = 1; i < tokens.size(); i++) {
+        const ArenaString &token = tokens[i];
+        if (token[0] == '-') {
+            if (token.find('a') != ArenaString::npos)
+                flag_a = true;
+            if (token.find('l') != ArenaString::npos)
+                flag_l = true;
+        } else {
+            dirs.push_back(token.c_str());
+        }
+    }
+    if (dirs.empty())
+        dirs.push_back(".");
+    bool color = format == OUT_TEXT && stdoutIsTty();
+    RecordWriter records(format);
+    int status = 0;
+    for (auto &dir : dirs) {
+        DIR *dp = opendir(dir.c_str());
+        if (dp == nullptr) {
+            perror(("ls: cannot access " + dir).c_str());
+            status = 1;
+            continue;
+        }
+        vector<LsEntry> entries;
+        struct dirent *entry;
+        while ((entry = readdir(dp)) != nullptr) {
+            if (!flag_a && entry->d_name[0] == '.')
+                continue;
+            LsEntry e;
+            e.name = entry->d_name;
+            // dirfd ke relative stat: har entry ke liye path string nahi banani
+            e.statOk = fstatat(dirfd(dp), entry->d_name, &e.sb, 0) == 0 ||
+                       fstatat(dirfd(dp), entry->d_name, &e.sb, AT_SYMLINK_NOFOLLOW) == 0;
+            e.isDir = e.statOk && S_ISDIR(e.sb.st_mode);
+            entries.push_back(move(e));
+        }
+        closedir(dp);
+        sort(entries.begin(), entries.end(), [](const LsEntry &a, const LsEntry &b) {
+            if (a.isDir != b.isDir)
+                return a.isDir > b.isDir;       // directories first
+            return a.name < b.name;
+        });
+        if (format != OUT_TEXT) {
+            for (auto &e : entries) {
+                records.begin();
+                records.str("dir", dir.data(), dir.size());
+                records.str("name", e.name.data(), e.name.size());
+                if (e.statOk) {
+                    records.str("type", fileTypeName(e.sb.st_mode));
+                    records.num("mode", e.sb.st_mode & 07777);
+                    records.num("nlink", e.sb.st_nlink);
+                    records.num("uid", e.sb.st_uid);
+                    records.str("owner", userName(e.sb.st_uid));
+                    records.num("gid", e.sb.st_gid);
+                    records.str("group", groupName(e.sb.st_gid));
+                    records.num("size", e.sb.st_size);
+                    records.num("mtime", e.sb.st_mtime);
+                }
+                records.end();
+            }
+        } else if (flag_l) {
+            for (auto &e : entries) {
+                if (!e.statOk) {
+                    cerr << "ls: cannot stat " << e.name << "\n";
+                    continue;
+                }
+                const struct stat &sb = e.sb;
+                char perms[11];
+                perms[0] = S_ISDIR(sb.st_mode) ? 'd' : '-';
+                perms[1] = (sb.st_mode & S_IRUSR) ? 'r' : '-';
+                perms[2] = (sb.st_mode & S_IWUSR) ? 'w' : '-';
+                perms[3] = (sb.st_mode & S_IXUSR) ? 'x' : '-';
+                perms[4] = (sb.st_mode & S_IRGRP) ? 'r' : '-';
+                perms[5] = (sb.st_mode & S_IWGRP) ? 'w' : '-';
+                perms[6] = (sb.st_mode & S_IXGRP) ? 'x' : '-';
+                perms[7] = (sb.st_mode & S_IROTH) ? 'r' : '-';
+                perms[8] = (sb.st_mode & S_IWOTH) ? 'w' : '-';
+                perms[9] = (sb.st_mode & S_IXOTH) ? 'x' : '-';
+                perms[10] = '\0';
+                char timebuf[80];
+                struct tm *timeinfo = localtime(&sb.st_mtime);
+                strftime(timebuf, sizeof(timebuf), "%b %d %H:%M", timeinfo);
+                cout << perms << " " << sb.st_nlink << " " 
+                    << userName(sb.st_uid) << " " 
+                    << groupName(sb.st_gid) << " " 
+                    << sb.st_size << " " << timebuf << " ";
+                if (e.isDir && color)
+                    cout << COLOR_CYAN << e.name << COLOR_RESET << "\n";
+                else
+                    cout << e.name << "\n";
+            }
+        } else {
+            for (auto &e : entries) {
+                if (e.isDir && color)
+                    cout << COLOR_CYAN << e.name << COLOR_RESET << "\n";
+                else
+                    cout << e.name << "\n";
+            }
+        }
+    }
+    return status;
+}
+
+int handlePinfo(const TokenList &args) {
+    TokenList tokens;
+    OutputFormat format = takeFormatFlags(args, tokens);
+    if (tokens.size() >= 2 && (tokens[1] == "-a" || tokens[1] == "-t"))
+        return handlePinfoAll(tokens, format);
+    pid_t pid = getpid();
+    if (tokens.size() >= 2) {
+        char *end;
+        long value = strtol(tokens[1].c_str(), &end, 10);
+        if (tokens.size() > 2 || end == tokens[1].c_str() || *end != '\0' || value <= 0 || value > INT_MAX) {
+            cerr << "Usage: pinfo [--json|-0] [pid] | pinfo -a|-t [-s] [-d seconds] [-n count] [-m rows]\n";
+            return 2;
+        }
+        pid = (pid_t)value;
+    }
+    stringstream ss;
+    ss << "/proc/" << pid << "/status";
+    ifstream statusFile(ss.str());
+    if (!statusFile.is_open()) {
+        cerr << "Error: Could not open status file for PID " << pid << "\n";
+        return 1;
+    }
+    string line, stateLine, vmLine;
+    while (getline(statusFile, line)) {
+        if (line.find("State:") != string::npos)
+            stateLine = line;
+        else if (line.find("VmSize:") != string::npos)
+            vmLine = line;
+    }
+    statusFile.close();
+    if (format == OUT_TEXT) {
+        if (!stateLine.empty())
+            cout << stateLine << "\n";
+        if (!vmLine.empty())
+            cout << vmLine << "\n";
+    }
+    ss.str("");
+    ss << "/proc/" << pid << "/exe";
+    char exePath[1024];
+    ssize_t len = readlink(ss.str().c_str(), exePath, sizeof(exePath) - 1);
+    if (len != -1)
+        exePath[len] = '\0';
+    if (format != OUT_TEXT) {
+        // "State:\tS (sleeping)" -> state "S", state_name "sleeping"; "VmSize:\t 1234 kB" -> 1234
+        RecordWriter record(format);
+        record.begin();
+        record.num("pid", pid);
+        size_t p = stateLine.find_first_not_of(" \t", 6);
+        if (p != string::npos) {
+            record.str("state", stateLine.data() + p, 1);
+            size_t open = stateLine.find('(', p), close = stateLine.rfind(')');
+            if (open != string::npos && close != string::npos && close > open)
+                record.str("state_name", stateLine.data() + open + 1, close - open - 1);
+        }
+        if (!vmLine.empty())
+            record.num("vm_size_kb", atoll(vmLine.c_str() + 7));
+        if (len != -1)
+            record.str("exe", exePath, len);
+        record.end();
+    } else if (len != -1) {
+        cout << "Executable Path: " << exePath << "\n";
+    }
+    if (len == -1) {
+        perror("readlink");
+        return 1;
+    }
+    return 0;
+}
+
+// ===================== Process Inspector (pinfo -a / -t) =====================
+
+// /proc ko getdents64 se enumerate karta hai aur har process ki stat file
+// ek cached fd par pread se padhta hai. stat mein vsize aur rss dono hain,
+// isliye statm alag se nahi padhna padta: ek process = ek syscall per refresh.
+
+struct linux_dirent64 {
+    uint64_t       d_ino;
+    int64_t        d_off;
+    unsigned short d_reclen;
+    unsigned char  d_type;
+    char           d_name[];
+};
+
+struct ProcSample {
+    int statFd;                     // cached /proc/<pid>/stat (-1: har baar open/close)
+    unsigned long long startTime;   // pid reuse pakadne ke liye
+    unsigned long long ticks;       // utime + stime
+    unsigned long long prevTicks;
+    unsigned long vsize;            // bytes
+    long rss;                       // pages
+    pid_t ppid, sid;
+    char state;
+    bool seen, hasPrev;
+    double cpu;
+    char comm[32];
+};
+
+class ProcInspector {
+public:
+    ProcInspector();
+    ~ProcInspector();
+    bool ok() const { return procFd >= 0; }
+    void refresh();
+    void render(string &out, bool sessionOnly, size_t maxRows, bool clearScreen);
+    void emit(RecordWriter &records, bool sessionOnly, size_t maxRows, long sample);
+
+private:
+    int procFd;
+    size_t cachedFds, maxCachedFds;
+    long clkTck, pageKb;
+    double lastTime, elapsed;
+    char dentBuf[64 * 1024];
+    char statBuf[4096];
+    unordered_map<pid_t, ProcSample> procs;
+    vector<const pair<const pid_t, ProcSample>*> order;
+
+    bool readStat(pid_t pid, ProcSample &ps);
+    void sortRows(bool sessionOnly);
+};
+
+ProcInspector::ProcInspector()
+    : cachedFds(0), lastTime(0), elapsed(0) {
+    procFd = open("/proc", O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    clkTck = sysconf(_SC_CLK_TCK);
+    pageKb = sysconf(_SC_PAGESIZE) / 1024;
+    // Aadhe fd limit tak stat fds cache karo, baaki ke liye open/pread/close
+    struct rlimit rl;
+    maxCachedFds = 256;
+    if (getrlimit(RLIMIT_NOFILE, &rl) == 0 && rl.rlim_cur != RLIM_INFINITY)
+        maxCachedFds = rl.rlim_cur / 2;
+    procs.reserve(1024);
+}
+
+ProcInspector::~ProcInspector() {
+    for (auto &p : procs) {
+        if (p.second.statFd >= 0)
+            close(p.second.statFd);
+    }
+    if (procFd >= 0)
+        close(procFd);
+}
+
+bool ProcInspector::readStat(pid_t pid, ProcSample &ps) {
+    char rel[32];
+    ssize_t n = -1;
+    for (int attempt = 0; attempt < 2 && n <= 0; attempt++) {
+        if (ps.statFd < 0) {
+            snprintf(rel, sizeof(rel), "%d/stat", (int)pid);
+            int fd = openat(procFd, rel, O_RDONLY | O_CLOEXEC);
+            if (fd < 0)
+                return false;
+            n = pread(fd, statBuf, sizeof(statBuf) - 1, 0);
+            if (cachedFds < maxCachedFds) {
+                ps.statFd = fd;
+                cachedFds++;
+            } else {
+                close(fd);
+            }
+        } else {
+            n = pread(ps.statFd, statBuf, sizeof(statBuf) - 1, 0);
+            if (n <= 0) {
+                // Purana process mar gaya (ESRCH); same pid naya ho sakta hai
+                close(ps.statFd);
+                ps.statFd = -1;
+                cachedFds--;
+            }
+        }
+    }
+    if (n <= 0)
+        return false;
+    statBuf[n] = '\0';
+    // comm mein spaces/parens ho sakte hain, isliye last ')' se parse karo
+    char *lparen = strchr(statBuf, '(');
+    char *rparen = strrchr(statBuf, ')');
+    if (!lparen || !rparen || rparen < lparen)
+        return false;
+    size_t commLen = min((size_t)(rparen - lparen - 1), sizeof(ps.comm) - 1);
+    memcpy(ps.comm, lparen + 1, commLen);
+    ps.comm[commLen] = '\0';
+    char *p = rparen + 2;
+    ps.state = *p;
+    p += 2;
+    // Fields 4.. (stat ke 1-based numbering mein): index 4 se shuru
+    unsigned long long fields[25] = {0};
+    for (int field = 4; field <= 24 && *p; field++) {
+        fields[field] = strtoull(p, &p, 10);
+        while (*p == ' ')
+            p++;
+    }
+    ps.ppid = (pid_t)fields[4];
+    ps.sid = (pid_t)fields[6];
+    unsigned long long startTime = fields[22];
+    if (ps.hasPrev && startTime != ps.startTime)
+        ps.hasPrev = false;     // pid reuse: naya process, baseline reset
+    ps.startTime = startTime;
+    ps.ticks = fields[14] + fields[15];
+    ps.vsize = fields[23];
+    ps.rss = (long)fields[24];
+    return true;
+}
+
+void ProcInspector::refresh() {
+    double now = clockNs() / 1e9;
+    elapsed = lastTime > 0 ? now - lastTime : 0;
+    lastTime = now;
+    for (auto &p : procs)
+        p.second.seen = false;
+    lseek(procFd, 0, SEEK_SET);
+    long n;
+    while ((n = syscall(SYS_getdents64, procFd, dentBuf, sizeof(dentBuf))) > 0) {
+        for (long off = 0; off < n; ) {
+            struct linux_dirent64 *d = reinterpret_cast<struct linux_dirent64*>(dentBuf + off);
+            off += d->d_reclen;
+            if (d->d_name[0] < '1' || d->d_name[0] > '9')
+                continue;
+            pid_t pid = (pid_t)strtol(d->d_name, nullptr, 10);
+            auto it = procs.find(pid);
+            if (it == procs.end()) {
+                ProcSample fresh;
+                memset(&fresh, 0, sizeof(fresh));
+                fresh.statFd = -1;
+                it = procs.emplace(pid, fresh).first;
+            }
+            ProcSample &ps = it->second;
+            ps.prevTicks = ps.ticks;
+            if (!readStat(pid, ps))
+                continue;
+            ps.cpu = (ps.hasPrev && elapsed > 0)
+                ? 100.0 * (ps.ticks - ps.prevTicks) / (elapsed * clkTck) : 0.0;
+            ps.hasPrev = true;
+            ps.seen = true;
+        }
+    }
+    // Jo processes khatam ho gaye unke fds band karo
+    for (auto it = procs.begin(); it != procs.end(); ) {
+        if (!it->second.seen) {
+            if (it->second.statFd >= 0) {
+                close(it->second.statFd);
+                cachedFds--;
+            }
+            it = procs.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+// CPU% ke hisaab se rows (session filter ke saath) order mein
+void ProcInspector::sortRows(bool sessionOnly) {
+    pid_t mySid = getsid(0);
+    order.clear();
+    for (auto &p : procs) {
+        if (!sessionOnly || p.second.sid == mySid)
+            order.push_back(&p);
+    }
+    sort(order.begin(), order.end(), [](const pair<const pid_t, ProcSample> *a,
+                                        const pair<const pid_t, ProcSample> *b) {
+        if (a->second.cpu != b->second.cpu)
+            return a->second.cpu > b->second.cpu;
+        return a->first < b->first;
+    });
+}
+
+void ProcInspector::render(string &out, bool sessionOnly, size_t maxRows, bool clearScreen) {
+    sortRows(sessionOnly);
+    out.clear();
+    if (clearScreen)
+        out += "\033[H\033[J";
+    char line[160];
+    snprintf(line, sizeof(line), "Processes: %zu  Interval: %.2fs\n%7s %7s %s %6s %10s %10s %s\n",
+             order.size(), elapsed, "PID", "PPID", "S", "CPU%", "VSZ(kB)", "RSS(kB)", "COMMAND");
+    out += line;
+    size_t rows = min(order.size(), maxRows);
+    for (size_t i = 0; i < rows; i++) {
+        const ProcSample &ps = order[i]->second;
+        snprintf(line, sizeof(line), "%7d %7d %c %6.1f %10lu %10ld %s\n",
+                 (int)order[i]->first, (int)ps.ppid, ps.state, ps.cpu,
+                 ps.vsize / 1024, ps.rss * pageKb, ps.comm);
+        out += line;
+    }
+}
+
+// Har process ek record; sample = kaunsa refresh (pinfo -t mein badhta hai)
+void ProcInspector::emit(RecordWriter &records, bool sessionOnly, size_t maxRows, long sample) {
+    sortRows(sessionOnly);
+    size_t rows = min(order.size(), maxRows);
+    for (size_t i = 0; i < rows; i++) {
+        const ProcSample &ps = order[i]->second;
+        records.begin();
+        records.num("sample", sample);
+        records.num("pid", order[i]->first);
+        records.num("ppid", ps.ppid);
+        records.str("state", &ps.state, 1);
+        records.real("cpu", ps.cpu);
+        records.num("vsize_kb", (long long)(ps.vsize / 1024));
+        records.num("rss_kb", (long long)ps.rss * pageKb);
+        records.str("comm", ps.comm);
+        records.end();
+    }
+    records.flush();
+}
+
+// pinfo -a [-s] [-d secs] [-m rows]: ek snapshot (CPU% -d interval par)
+// pinfo -t [-s] [-d secs] [-n count] [-m rows]: top-style refresh, Ctrl-C se band
+int handlePinfoAll(const TokenList &tokens, OutputFormat format) {
+    bool topMode = tokens[1] == "-t";
+    bool sessionOnly = false;
+    double interval = topMode ? 1.0 : 0.5;
+    long iterations = topMode ? 0 : 1;      // 0 = jab tak Ctrl-C na ho
+    size_t maxRows = (size_t)-1;
+    for (size_t i = 2; i < tokens.size(); i++) {
+        bool hasValue = i + 1 < tokens.size();
+        // -d / -n / -m ki value poori number aur positive honi chahiye
+        bool ok = true;
+        char *end = nullptr;
+        const char *value = hasValue ? tokens[i + 1].c_str() : nullptr;
+        if (tokens[i] == "-s") {
+            sessionOnly = true;
+            continue;
+        } else if (tokens[i] == "-d" && hasValue) {
+            interval = strtod(value, &end);
+            ok = interval > 0;
+        } else if (tokens[i] == "-n" && hasValue) {
+            iterations = strtol(value, &end, 10);
+            ok = iterations > 0;
+        } else if (tokens[i] == "-m" && hasValue) {
+            long rows = strtol(value, &end, 10);
+            ok = rows > 0;
+            maxRows = (size_t)rows;
+        } else {
+            ok = false;
+        }
+        if (!ok || end == value || *end != '\0') {
+            cerr << "Usage: pinfo -a|-t [-s] [-d seconds] [-n count] [-m rows]\n";
+            return 2;
+        }
+        i++;
+    }
+    if (interval < 0.01)
+        interval = 0.01;
+    bool tty = format == OUT_TEXT && stdoutIsTty();
+    struct winsize ws;
+    if (topMode && tty && maxRows == (size_t)-1 &&
+        ioctl(STDOUT_FILENO, TIOCGWINSZ, &ws) == 0 && ws.ws_row > 3)
+        maxRows = ws.ws_row - 3;
+
+    ProcInspector inspector;
+    if (!inspector.ok()) {
+        perror("pinfo: /proc");
+        return 1;
+    }
+    string out;
+    out.reserve(64 * 1024);
+    RecordWriter records(format);
+    interruptRequested = 0;
+    inspector.refresh();        // baseline sample
+    for (long iter = 0; !interruptRequested && (iterations == 0 || iter < iterations); iter++) {
+        struct timespec ts;
+        ts.tv_sec = (time_t)interval;
+        ts.tv_nsec = (long)((interval - ts.tv_sec) * 1e9);
+        while (nanosleep(&ts, &ts) != 0 && errno == EINTR && !interruptRequested) {}
+        if (interruptRequested)
+            break;
+        inspector.refresh();
+        if (format != OUT_TEXT) {
+            inspector.emit(records, sessionOnly, maxRows, iter);
+            cout.flush();
+            continue;
+        }
+        inspector.render(out, sessionOnly, maxRows, topMode && tty);
+        cout.write(out.data(), out.size());
+        cout.flush();
+    }
+    interruptRequested = 0;
+    return 0;
+}
+
+// ===================== Content Search (search -c) =====================
+
+// search -c <pattern> [dir]: files ko line-aligned chunks mein baant ke ek
+// thread pool scan karta hai. Bade files mmap, chhote/special files pread se.
+// Main thread chunks ko file-list order mein print karta hai (deterministic),
+// line numbers pichhle chunks ke newline counts jod ke bante hain.
+
+const size_t SEARCH_CHUNK = 32 * 1024 * 1024;   // ek work item kitna bada
+const size_t SEARCH_MMAP_MIN = 64 * 1024;       // isse chhote files seedha pread
+const size_t SEARCH_BINARY_PROBE = 8192;        // pehle itne bytes mein NUL = binary
+
+typedef const char *(*FindKernel)(const char *hay, size_t len, const char *needle, size_t n);
+typedef size_t (*CountKernel)(const char *s, size_t len);
+
+static const char *findScalar(const char *hay, size_t len, const char *needle, size_t n) {
+    if (n == 1)
+        return static_cast<const char*>(memchr(hay, needle[0], len));
+    return static_cast<const char*>(memmem(hay, len, needle, n));
+}
+
+static size_t countNewlinesScalar(const char *s, size_t len) {
+    size_t count = 0;
+    const char *end = s + len;
+    while ((s = static_cast<const char*>(memchr(s, '\n', end - s))) != nullptr) {
+        count++;
+        s++;
+    }
+    return count;
+}
+
+#if ISHELL_X86_SIMD
+// Needle ke pehle aur aakhri byte ko 16 positions par ek saath compare karo;
+// dono match hon wahi candidates memcmp se verify hote hain.
+static const char *findSse2(const char *hay, size_t len, const char *needle, size_t n) {
+    if (n < 2 || len < n)
+        return findScalar(hay, len, needle, n);
+    const __m128i first = _mm_set1_epi8(needle[0]);
+    const __m128i last = _mm_set1_epi8(needle[n - 1]);
+    size_t i = 0;
+    for (; i + n - 1 + 16 <= len; i += 16) {
+        __m128i a = _mm_loadu_si128((const __m128i *)(hay + i));
+        __m128i b = _mm_loadu_si128((const __m128i *)(hay + i + n - 1));
+        unsigned mask = (unsigned)_mm_movemask_epi8(
+            _mm_and_si128(_mm_cmpeq_epi8(a, first), _mm_cmpeq_epi8(b, last)));
+        while (mask) {
+            unsigned bit = __builtin_ctz(mask);
+            if (memcmp(hay + i + bit + 1, needle + 1, n - 2) == 0)
+                return hay + i + bit;
+            mask &= mask - 1;
+        }
+    }
+    return findScalar(hay + i, len - i, needle, n);
+}
+
+__attribute__((target("avx2")))
+static const char *findAvx2(const char *hay, size_t len, const char *needle, size_t n) {
+    if (n < 2 || len < n)
+        return findScalar(hay, len, needle, n);
+    const __m256i first = _mm256_set1_epi8(needle[0]);
+    const __m256i last = _mm256_set1_epi8(needle[n - 1]);
+    size_t i = 0;
+    for (; i + n - 1 + 32 <= len; i += 32) {
+        __m256i a = _mm256_loadu_si256((const __m256i *)(hay + i));
+        __m256i b = _mm256_loadu_si256((const __m256i *)(hay + i + n - 1));
+        unsigned mask = (unsigned)_mm256_movemask_epi8(
+            _mm256_and_si256(_mm256_cmpeq_epi8(a, first), _mm256_cmpeq_epi8(b, last)));
+        while (mask) {
+            unsigned bit = __builtin_ctz(mask);
+            if (memcmp(hay + i + bit + 1, needle + 1, n - 2) == 0)
+                return hay + i + bit;
+            mask &= mask - 1;
+        }
+    }
+    return findScalar(hay + i, len - i, needle, n);
+}
+
+// '\n' compare ka result (-1) byte counters mein jodo; 255 iterations se pehle
+// _mm_sad_epu8 se 64-bit totals mein fold karo taaki counters overflow na hon
+static size_t countNewlinesSse2(const char *s, size_t len) {
+    const __m128i nl = _mm_set1_epi8('\n');
+    size_t i = 0, count = 0;
+    while (i + 16 <= len) {
+        __m128i acc = _mm_setzero_si128();
+        for (int k = 0; k < 255 && i + 16 <= len; k++, i += 16)
+            acc = _mm_sub_epi8(acc, _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)(s + i)), nl));
+        __m128i sums = _mm_sad_epu8(acc, _mm_setzero_si128());
+        count += (size_t)_mm_extract_epi16(sums, 0) + (size_t)_mm_extract_epi16(sums, 4);
+    }
+    return count + countNewlinesScalar(s + i, len - i);
+}
+
+__attribute__((target("avx2")))
+static size_t countNewlinesAvx2(const char *s, size_t len) {
+    const __m256i nl = _mm256_set1_epi8('\n');
+    size_t i = 0, count = 0;
+    while (i + 32 <= len) {
+        __m256i acc = _mm256_setzero_si256();
+        for (int k = 0; k < 255 && i + 32 <= len; k++, i += 32)
+            acc = _mm256_sub_epi8(acc, _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i *)(s + i)), nl));
+        __m256i sums = _mm256_sad_epu8(acc, _mm256_setzero_si256());
+        count += (size_t)_mm256_extract_epi16(sums, 0) + (size_t)_mm256_extract_epi16(sums, 4) +
+                 (size_t)_mm256_extract_epi16(sums, 8) + (size_t)_mm256_extract_epi16(sums, 12);
+    }
+    return count + countNewlinesScalar(s + i, len - i);
+}
+#endif
+
+struct SearchKernels {
+    FindKernel find;
+    CountKernel count;
+    SearchKernels() {
+#if ISHELL_X86_SIMD
+        __builtin_cpu_init();
+        bool avx2 = __builtin_cpu_supports("avx2");
+        find = avx2 ? findAvx2 : findSse2;
+        count = avx2 ? countNewlinesAvx2 : countNewlinesSse2;
+#else
+        find = findScalar;
+        count = countNewlinesScalar;
+#endif
+    }
+};
+
+struct SearchFile {
+    string path;
+    off_t size;
+    bool special;           // st_size bharosemand nahi (procfs/sysfs): poora pread
+};
+
+struct SearchMatch {
+    size_t line;            // chunk ke andar 0-based line index
+    size_t offset, len;     // text mein line ka hissa
+};
+
+// Ek work item: file ka [begin, end) hissa. Chunk apne range mein shuru hone
+// wali lines ka maalik hai (aakhri line range ke baad tak ja sakti hai).
+struct SearchChunk {
+    size_t file;
+    size_t begin, end;
+    bool done;
+    bool binary;
+    string error;
+    size_t newlines;        // range mein owned lines ke newlines (agle chunk ka base)
+    string text;
+    vector<SearchMatch> matches;
+};
+
+// Directory walk; har directory sorted, isliye file order deterministic hai
+static void collectSearchFiles(const string &dir, vector<SearchFile> &files) {
+    DIR *dp = opendir(dir.c_str());
+    if (!dp) {
+        cerr << "search: " << dir << ": " << strerror(errno) << "\n";
+        return;
+    }
+    vector<pair<string, bool>> entries;     // naam, directory?
+    struct dirent *entry;
+    while ((entry = readdir(dp)) != nullptr) {
+        const char *name = entry->d_name;
+        if (strcmp(name, ".") == 0 || strcmp(name, "..") == 0)
+            continue;
+        struct stat st;
+        // Symlinked directories follow nahi hote (loops); files ke symlinks hote hain
+        if (fstatat(dirfd(dp), name, &st, AT_SYMLINK_NOFOLLOW) != 0)
+            continue;
+        if (S_ISLNK(st.st_mode) && (fstatat(dirfd(dp), name, &st, 0) != 0 || S_ISDIR(st.st_mode)))
+            continue;
+        if (S_ISDIR(st.st_mode) || S_ISREG(st.st_mode))
+            entries.emplace_back(name, S_ISDIR(st.st_mode));
+    }
+    closedir(dp);
+    sort(entries.begin(), entries.end());
+    for (auto &e : entries) {
+        string path = (dir == "." ? e.first : dir + "/" + e.first);
+        if (e.second) {
+            collectSearchFiles(path, files);
+            continue;
+        }
+        struct stat st;
+        if (stat(path.c_str(), &st) != 0)
+            continue;
+        SearchFile f;
+        f.path = path;
+        f.size = st.st_size;
+        f.special = st.st_size == 0;
+        files.push_back(f);
+    }
+}
+
+class ContentSearch {
+public:
+    ContentSearch(const string &pattern, vector<SearchFile> &files)
+        : pattern(pattern), files(files), next(0), stop(false) {}
+    bool run(OutputFormat format);      // true = koi match mila
+
+private:
+    SearchKernels kernels;
+    string pattern;
+    vector<SearchFile> &files;
+    vector<SearchChunk> chunks;
+    atomic<size_t> next;
+    atomic<bool> stop;
+    mutex lock;
+    condition_variable chunkDone;
+
+    void worker();
+    void scanChunk(SearchChunk &c);
+    void scanBuffer(SearchChunk &c, const char *data, size_t size);
+};
+
+void ContentSearch::worker() {
+    size_t i;
+    while (!stop.load(memory_order_relaxed) && (i = next.fetch_add(1)) < chunks.size()) {
+        scanChunk(chunks[i]);
+        lock_guard<mutex> guard(lock);
+        chunks[i].done = true;
+        chunkDone.notify_all();
+    }
+}
+
+// File kholo; mmap (bade regular files) ya pread (chhote / special) se data lo
+void ContentSearch::scanChunk(SearchChunk &c) {
+    const SearchFile &f = files[c.file];
+    int fd = open(f.path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        c.error = f.path + ": " + strerror(errno);
+        return;
+    }
+    if (!f.special && (size_t)f.size >= SEARCH_MMAP_MIN) {
+        void *map = mmap(nullptr, f.size, PROT_READ, MAP_PRIVATE, fd, 0);
+        close(fd);
+        if (map == MAP_FAILED) {
+            c.error = f.path + ": " + strerror(errno);
+            return;
+        }
+        size_t pageStart = c.begin & ~(size_t)(sysconf(_SC_PAGESIZE) - 1);
+        madvise(static_cast<char*>(map) + pageStart, min((size_t)f.size, c.end + 4096) - pageStart,
+                MADV_SEQUENTIAL);
+        scanBuffer(c, static_cast<const char*>(map), f.size);
+        munmap(map, f.size);
+        return;
+    }
+    // Chhota ya special file: 1 MiB blocks mein pread (special files ka size pata nahi)
+    vector<char> data;
+    size_t len = 0;
+    while (true) {
+        if (data.size() - len < 1024 * 1024)
+            data.resize(len + 1024 * 1024);
+        ssize_t n = pread(fd, data.data() + len, data.size() - len, len);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            break;
+        len += (size_t)n;
+        if (!f.special && len >= (size_t)f.size)
+            break;
+    }
+    close(fd);
+    c.end = len;
+    scanBuffer(c, data.data(), len);
+}
+
+void ContentSearch::scanBuffer(SearchChunk &c, const char *data, size_t size) {
+    if (memchr(data, '\0', min(size, SEARCH_BINARY_PROBE))) {
+        c.binary = true;
+        return;
+    }
+    // Chunk sirf woh lines scan karta hai jo [begin, end) mein shuru hoti hain;
+    // pichhle chunk ki adhoori line skip, aakhri line poori (limit tak) padho
+    size_t end = min(c.end, size);
+    size_t begin = c.begin;
+    if (begin > 0) {
+        const char *nl = static_cast<const char*>(memchr(data + begin - 1, '\n', size - begin + 1));
+        begin = nl ? (size_t)(nl - data) + 1 : size;
+    }
+    if (begin >= end)
+        return;
+    const char *tail = static_cast<const char*>(memchr(data + end - 1, '\n', size - end + 1));
+    size_t limit = tail ? (size_t)(tail - data) + 1 : size;
+
+    // Newlines sirf match tak gine jaate hain; beech ka data kernel ek baar hi dekhta hai
+    size_t line = 0, counted = begin, pos = begin;
+    while (pos < limit && !stop.load(memory_order_relaxed)) {
+        const char *hit = kernels.find(data + pos, limit - pos, pattern.data(), pattern.size());
+        if (!hit)
+            break;
+        size_t at = (size_t)(hit - data);
+        const char *prev = static_cast<const char*>(memrchr(data + counted, '\n', at - counted));
+        size_t lineStart = prev ? (size_t)(prev - data) + 1 : counted;
+        line += kernels.count(data + counted, lineStart - counted);
+        const char *nl = static_cast<const char*>(memchr(hit, '\n', limit - at));
+        size_t lineEnd = nl ? (size_t)(nl - data) : limit;
+        SearchMatch m;
+        m.line = line;
+        m.offset = c.text.size();
+        m.len = lineEnd - lineStart;
+        c.text.append(data + lineStart, m.len);
+        c.matches.push_back(m);
+        counted = lineStart;
+        pos = lineEnd + 1;
+    }
+    c.newlines = line + kernels.count(data + counted, limit - counted);
+}
+
+bool ContentSearch::run(OutputFormat format) {
+    for (size_t i = 0; i < files.size(); i++) {
+        size_t size = files[i].special ? 0 : (size_t)files[i].size;
+        size_t begin = 0;
+        do {
+            SearchChunk c;
+            c.file = i;
+            c.begin = begin;
+            c.end = (files[i].special || size - begin <= SEARCH_CHUNK) ? size : begin + SEARCH_CHUNK;
+            c.done = c.binary = false;
+            c.newlines = 0;
+            chunks.push_back(move(c));
+            begin = chunks.back().end;
+        } while (begin < size);
+    }
+    unsigned threads = max(1u, thread::hardware_concurrency());
+    threads = (unsigned)min((size_t)threads, chunks.size());
+    vector<thread> pool;
+    for (unsigned t = 0; t < threads; t++)
+        pool.emplace_back(&ContentSearch::worker, this);
+
+    // Chunks ko order mein print karo; bache hue kaam ke saath overlap hota hai
+    bool any = false;
+    RecordWriter records(format);
+    string out;
+    out.reserve(64 * 1024 + 4096);
+    size_t lineBase = 0, lastFile = (size_t)-1;
+    char num[24];
+    for (size_t i = 0; i < chunks.size(); i++) {
+        {
+            // Timeout ke saath wait taaki Ctrl-C (interruptRequested) bhi dikhe
+            unique_lock<mutex> guard(lock);
+            while (!chunks[i].done && !interruptRequested)
+                chunkDone.wait_for(guard, chrono::milliseconds(50));
+            if (interruptRequested)
+                stop = true;
+        }
+        if (stop.load())
+            break;
+        SearchChunk &c = chunks[i];
+        if (c.file != lastFile) {
+            lastFile = c.file;
+            lineBase = 0;
+        }
+        if (!c.error.empty() && c.begin == 0)
+            cerr << "search: " << c.error << "\n";
+        const string &path = files[c.file].path;
+        for (const SearchMatch &m : c.matches) {
+            any = true;
+            size_t lineNo = lineBase + m.line + 1;
+            if (format != OUT_TEXT) {
+                records.begin();
+                records.str("file", path.data(), path.size());
+                records.num("line", (long long)lineNo);
+                records.str("text", c.text.data() + m.offset, m.len);
+                records.end();
+                continue;
+            }
+            int n = snprintf(num, sizeof(num), ":%zu:", lineNo);
+            out.append(path);
+            out.append(num, n);
+            out.append(c.text, m.offset, m.len);
+            out.push_back('\n');
+            if (out.size() >= 64 * 1024) {
+                cout.write(out.data(), out.size());
+                out.clear();
+            }
+        }
+        lineBase += c.newlines;
+        string().swap(c.text);
+        vector<SearchMatch>().swap(c.matches);
+    }
+    cout.write(out.data(), out.size());
+    stop = true;
+    for (thread &t : pool)
+        t.join();
+    return any;
+}
+
+// search -c <pattern> [dir]: 0 = match mila, 1 = nahi, 2 = usage/error
+int handleContentSearch(const TokenList &tokens, OutputFormat format) {
+    if (tokens.size() < 3 || tokens.size() > 4 || tokens[2].empty()) {
+        cerr << "Usage: search [--json|-0] -c <pattern> [dir]\n";
+        return 2;
+    }
+    string dir = tokens.size() == 4 ? string(tokens[3].c_str()) : string(".");
+    struct stat st;
+    if (stat(dir.c_str(), &st) != 0) {
+        cerr << "search: " << dir << ": " << strerror(errno) << "\n";
+        return 2;
+    }
+    vector<SearchFile> files;
+    if (S_ISDIR(st.st_mode)) {
+        collectSearchFiles(dir, files);
+    } else {
+        SearchFile f;
+        f.path = dir;
+        f.size = st.st_size;
+        f.special = !S_ISREG(st.st_mode) || st.st_size == 0;
+        files.push_back(f);
+    }
+    interruptRequested = 0;
+    ContentSearch search(string(tokens[2].c_str()), files);
+    bool found = search.run(format);
+    bool interrupted = interruptRequested;
+    interruptRequested = 0;
+    cout.flush();
+    return interrupted ? 130 : (found ? 0 : 1);
+}
+
+bool searchRecursive(const char *basePath, const string &target, string *foundPath) {
+    DIR *dir = opendir(basePath);
+    if (!dir)
+        return false;
+    struct dirent *entry;
+    bool found = false;
+    while ((entry = readdir(dir)) != nullptr) {
+        if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0)
+            continue;
+        string path = string(basePath) + "/" + entry->d_name;
+        if (string(entry->d_name) == target) {
+            if (foundPath)
+                *foundPath = path;
+            found = true;
+            break;
+        }
+        struct stat sb;
+        if (stat(path.c_str(), &sb) == 0 && S_ISDIR(sb.st_mode)) {
+            if (searchRecursive(path.c_str(), target, foundPath)) {
+                found = true;
+                break;
+            }
+        }
+    }
+    closedir(dir);
+    return found;
+}
+
+int handleSearch(const TokenList &args) {
+    TokenList tokens;
+    OutputFormat format = takeFormatFlags(args, tokens);
+    if (tokens.size() >= 2 && tokens[1] == "-c")
+        return handleContentSearch(tokens, format);
+    if (tokens.size() != 2) {
+        cerr << "Usage: search [--json|-0] <filename> | search [--json|-0] -c <pattern> [dir]\n";
+        return 1;
+    }
+    string path;
+    bool found = searchRecursive(".", tokens[1].c_str(), &path);
+    if (format == OUT_TEXT) {
+        cout << (found ? "True" : "False") << "\n";
+    } else {
+        RecordWriter record(format);
+        record.begin();
+        record.str("name", tokens[1].data(), tokens[1].size());
+        record.boolean("found", found);
+        if (found)
+            record.str("path", path.data(), path.size());
+        record.end();
+    }
+    return found ? 0 : 1;
+}
+
+int handleHistory(const TokenList &args) {
+    TokenList tokens;
+    OutputFormat format = takeFormatFlags(args, tokens);
+    int num = 10;
+    if (tokens.size() >= 2) {
+        char *end;
+        long value = strtol(tokens[1].c_str(), &end, 10);
+        if (tokens.size() > 2 || end == tokens[1].c_str() || *end != '\0' || value < 0 || value > INT_MAX) {
+            cerr << "Usage: history [--json|-0] [count]\n";
+            return 2;
+        }
+        num = (int)value;
+    }
+    int count = 0, total = history.size();
+    RecordWriter records(format);
+    for (auto it = history.begin(); it != history.end(); ++it) {
+        if (total - count <= num) {
+            if (format == OUT_TEXT) {
+                cout << *it << "\n";
+            } else {
+                records.begin();
+                records.num("index", count + 1);
+                records.str("command", it->data(), it->size());
+                records.end();
+            }
+        }
+        count++;
+    }
+    return 0;
+}
+
+// test / [ : unary file/string tests aur binary string/integer comparisons
+static int testUnary(const ArenaString &op, const ArenaString &arg) {
+    struct stat sb;
+    const char *path = arg.c_str();
+    if (op == "-z") return arg.empty() ? 0 : 1;
+    if (op == "-n") return arg.empty() ? 1 : 0;
+    if (op == "-e") return stat(path, &sb) == 0 ? 0 : 1;
+    if (op == "-f") return (stat(path, &sb) == 0 && S_ISREG(sb.st_mode)) ? 0 : 1;
+    if (op == "-d") return (stat(path, &sb) == 0 && S_ISDIR(sb.st_mode)) ? 0 : 1;
+    if (op == "-s") return (stat(path, &sb) == 0 && sb.st_size > 0) ? 0 : 1;
+    if (op == "-L") return (lstat(path, &sb) == 0 && S_ISLNK(sb.st_mode)) ? 0 : 1;
+    if (op == "-r") return access(path, R_OK) == 0 ? 0 : 1;
+    if (op == "-w") return access(path, W_OK) == 0 ? 0 : 1;
+    if (op == "-x") return access(path, X_OK) == 0 ? 0 : 1;
+    cerr << "test: " << op << ": unary operator expected\n";
+    return 2;
+}
+
+static int testBinary(const ArenaString &lhs, const ArenaString &op, const ArenaString &rhs) {
+    if (op == "=" || op == "==") return lhs == rhs ? 0 : 1;
+    if (op == "!=") return lhs != rhs ? 0 : 1;
+    long long a = strtoll(lhs.c_str(), nullptr, 10);
+    long long b = strtoll(rhs.c_str(), nullptr, 10);
+    if (op == "-eq") return a == b ? 0 : 1;
+    if (op == "-ne") return a != b ? 0 : 1;
+    if (op == "-lt") return a < b ? 0 : 1;
+    if (op == "-le") return a <= b ? 0 : 1;
+    if (op == "-gt") return a > b ? 0 : 1;
+    if (op == "-ge") return a >= b ? 0 : 1;
+    cerr << "test: " << op << ": binary operator expected\n";
+    return 2;
+}
+
+int handleTest(const TokenList &tokens) {
+    size_t argc = tokens.size();
+    if (tokens[0] == "[") {
+        if (tokens[argc - 1] != "]") {
+            cerr << "[: missing ']'\n";
+            return 2;
+        }
+        argc--;
+    }
+    size_t i = 1;
+    bool negate = false;
+    if (argc - i >= 2 && tokens[i] == "!") {
+        negate = true;
+        i++;
+    }
+    int result;
+    switch (argc - i) {
+    case 0: result = 1; break;
+    case 1: result = tokens[i].empty() ? 1 : 0; break;
+    case 2: result = testUnary(tokens[i], tokens[i + 1]); break;
+    case 3: result = testBinary(tokens[i], tokens[i + 1], tokens[i + 2]); break;
+    default:
+        cerr << "test: too many arguments\n";
+        return 2;
+    }
+    if (negate && result != 2)
+        result = !result;
+    return result;
+}
+
+int handleExport(const TokenList &tokens) {
+    if (tokens.size() == 1) {
+        for (char **env = environ; *env; env++)
+            cout << "export " << *env << "\n";
+        return 0;
+    }
+    for (size_t i = 1; i < tokens.size(); i++) {
+        const ArenaString &arg = tokens[i];
+        size_t eq = arg.find('=');
+        if (eq != ArenaString::npos) {
+            string name(arg.c_str(), eq);
+            shellVars[name] = arg.c_str() + eq + 1;
+            setenv(name.c_str(), arg.c_str() + eq + 1, 1);
+        } else {
+            auto it = shellVars.find(arg.c_str());
+            const char *value = (it != shellVars.end()) ? it->second.c_str() : getenv(arg.c_str());
+            setenv(arg.c_str(), value ? value : "", 1);
+        }
+    }
+    return 0;
+}
+
+// unset NAME... / unset -f NAME...
+int handleUnset(const TokenList &tokens) {
+    bool funcs = tokens.size() > 1 && tokens[1] == "-f";
+    for (size_t i = funcs ? 2 : 1; i < tokens.size(); i++) {
+        if (funcs) {
+            functions.erase(tokens[i].c_str());
+        } else {
+            shellVars.erase(tokens[i].c_str());
+            unsetenv(tokens[i].c_str());
+        }
+    }
+    return 0;
+}
+
+// alias name='value' (single quotes escape karke, taaki output dobara chal sake)
+static void printAlias(const string &name, const ShellAlias &alias) {
+    cout << "alias " << name << "='";
+    for (char c : alias.value) {
+        if (c == '\'')
+            cout << "'\\''";
+        else
+            cout << c;
+    }
+    cout << "'\n";
+}
+
+// alias / alias name=value... / alias name...
+int handleAlias(const TokenList &tokens) {
+    if (tokens.size() == 1) {
+        vector<const string *> names;
+        for (const auto &a : aliases)
+            names.push_back(&a.first);
+        sort(names.begin(), names.end(), [](const string *x, const string *y) { return *x < *y; });
+        for (const string *name : names)
+            printAlias(*name, *aliases[*name]);
+        return 0;
+    }
+    int status = 0;
+    for (size_t i = 1; i < tokens.size(); i++) {
+        const ArenaString &arg = tokens[i];
+        size_t eq = arg.find('=');
+        if (eq == ArenaString::npos) {
+            auto it = aliases.find(arg.c_str());
+            if (it == aliases.end()) {
+                cerr << "alias: " << arg << ": not found\n";
+                status = 1;
+            } else {
+                printAlias(it->first, *it->second);
+            }
+            continue;
+        }
+        string name(arg.c_str(), eq);
+        if (name.empty() || name.find_first_of(" \t\n/|&;()<>$`\\\"'") != string::npos) {
+            cerr << "alias: " << name << ": invalid alias name\n";
+            status = 1;
+            continue;
+        }
+        // Value ek hi baar parse hota hai; words alias ke apne arena mein rehte hain
+        shared_ptr<ShellAlias> alias = make_shared<ShellAlias>();
+        alias->value = arg.c_str() + eq + 1;
+        ParseStatus parseStatus;
+        Node *program = parseProgram(alias->value.data(), alias->value.size(), alias->arena, parseStatus);
+        if (parseStatus != PARSE_OK || (program && (program->next || program->kind != N_SIMPLE ||
+                                                    program->background || program->negate ||
+                                                    program->assigns || program->redirs))) {
+            cerr << "alias: " << name << ": value must be a simple command\n";
+            status = 1;
+            continue;
+        }
+        alias->words = program ? program->words : nullptr;
+        aliases[name] = alias;
+    }
+    return status;
+}
+
+// unalias name... / unalias -a
+int handleUnalias(const TokenList &tokens) {
+    if (tokens.size() == 1) {
+        cerr << "Usage: unalias -a | unalias name...\n";
+        return 2;
+    }
+    if (tokens[1] == "-a") {
+        aliases.clear();
+        return 0;
+    }
+    int status = 0;
+    for (size_t i = 1; i < tokens.size(); i++) {
+        if (!aliases.erase(tokens[i].c_str())) {
+            cerr << "unalias: " << tokens[i] << ": not found\n";
+            status = 1;
+        }
+    }
+    return status;
+}
+
+// break [n] / continue [n]
+int handleLoopControl(const TokenList &tokens) {
+    if (loopDepth == 0)
+        return 0;
+    int levels = tokens.size() > 1 ? atoi(tokens[1].c_str()) : 1;
+    if (levels < 1) {
+        cerr << tokens[0] << ": loop count out of range\n";
+        return 1;
+    }
+    levels = min(levels, loopDepth);
+    if (tokens[0] == "break")
+        breakLevels = levels;
+    else
+        continueLevels = levels;
+    return 0;
+}
+
+int handleReturn(const TokenList &tokens) {
+    if (functionDepth == 0) {
+        cerr << "return: can only `return' from a function\n";
+        return 1;
+    }
+    returnRequested = true;
+    return tokens.size() > 1 ? atoi(tokens[1].c_str()) & 0xff : lastStatus;
+}
+
+int handleExit(const TokenList &tokens) {
+    int code = tokens.size() > 1 ? atoi(tokens[1].c_str()) & 0xff : lastStatus;
+    flushOutput();
+    resetTerminal();
+    exit(code);
+}
+
+// ===================== Command Execution =====================
+
+// break/continue/return ya Ctrl-C pending hai: list ka baaki hissa skip karo
+static bool controlPending() {
+    return breakLevels > 0 || continueLevels > 0 || returnRequested || interruptRequested;
+}
+
+// Loop iteration ke baad: loop ko rukna chahiye? 'break N'/'continue N'
+// har loop level par ek count consume karte hain.
+static bool loopShouldStop() {
+    if (returnRequested || interruptRequested)
+        return true;
+    if (breakLevels > 0) {
+        breakLevels--;
+        return true;
+    }
+    if (continueLevels > 0) {
+        continueLevels--;
+        return continueLevels > 0;
+    }
+    return false;
+}
+
+static int runBackground(Node *n) {
+    flushOutput();
+    pid_t pid = fork();
+    if (pid == 0) {
+        applyLaunchInChild();
+        int status = execNode(n, true);
+        flushOutput();
+        _exit(status);
+    } else if (pid < 0) {
+        perror("fork");
+        return 1;
+    }
+    bool color = stdoutIsTty();
+    cout << (color ? COLOR_YELLOW : "") << "Process running in background with PID: "
+        << pid << (color ? COLOR_RESET : "") << "\n";
+    return 0;
+}
+
+static int runSubshell(Node *n) {
+    ChildSignalBlock block;
+    flushOutput();
+    pid_t pid = fork();
+    if (pid == 0) {
+        block.restoreInChild();
+        applyLaunchInChild();
+        int status = execList(n->cond);
+        flushOutput();
+        _exit(status);
+    } else if (pid < 0) {
+        perror("fork");
+        return 1;
+    }
+    return waitForeground(pid);
+}
+
+static int callFunction(const shared_ptr<ShellFunction> &fn, TokenList &tokens, Node *n) {
+    if (functionDepth >= MAX_FUNCTION_DEPTH) {
+        cerr << "ishell: " << tokens[0] << ": maximum function nesting level exceeded\n";
+        return 1;
+    }
+    // Body execution ke dauran function redefine ho sakta hai: reference pakad ke rakho
+    shared_ptr<ShellFunction> keep = fn;
+    ArgVector args;
+    args.reserve(tokens.size());
+    for (size_t i = 1; i < tokens.size(); i++)
+        args.push_back(const_cast<char*>(tokens[i].c_str()));
+    char **savedArgs = positionalArgs;
+    int savedCount = positionalCount;
+    positionalArgs = args.data();
+    positionalCount = args.size();
+    int status = 1;
+    {
+        RedirectionGuard guard(n->redirs);
+        if (guard.ok()) {
+            functionDepth++;
+            status = execNode(keep->body, false);
+            functionDepth--;
+        }
+    }
+    if (returnRequested) {
+        returnRequested = false;
+        status = lastStatus;
+    }
+    positionalArgs = savedArgs;
+    positionalCount = savedCount;
+    return status;
+}
+
+int handleTrue(const TokenList &tokens) {
+    (void)tokens;
+    return 0;
+}
+
+int handleFalse(const TokenList &tokens) {
+    (void)tokens;
+    return 1;
+}
+
+// Assignments aur redirections har builtin par ek hi tarah lagte hain
+static int runBuiltin(const BuiltinDesc &b, TokenList &tokens, Node *n) {
+    if (n->redirs && !(b.flags & BI_REDIRECT)) {
+        cerr << b.name << ": redirection not supported" << endl;
+        return 1;
+    }
+    for (const Word *a = n->assigns; a; a = a->next) {
+        ArenaString value = expandWordString(a);
+        if (takeExpansionError())
+            return 1;
+        setVar(a->assignName, value.c_str());
+    }
+    RedirectionGuard guard(n->redirs);
+    return guard.ok() ? b.handler(tokens) : 1;
+}
+
+const int MAX_ALIAS_DEPTH = 16;
+
+// tokens[0] alias ho to uske words se badlo; naya pehla word bhi alias ho sakta hai
+// ('alias ll="ls -l"', 'alias l=ll'). Ek alias dobara expand nahi hota, isliye
+// 'alias ls="ls -a"' loop nahi banta.
+static void expandAliases(TokenList &tokens) {
+    shared_ptr<ShellAlias> used[MAX_ALIAS_DEPTH];
+    int depth = 0;
+    while (!tokens.empty() && depth < MAX_ALIAS_DEPTH) {
+        auto it = aliases.find(tokens[0].c_str());
+        if (it == aliases.end())
+            return;
+        for (int k = 0; k < depth; k++) {
+            if (used[k] == it->second)
+                return;
+        }
+        // $(...) ke andar 'unalias' bhi chale to alias zinda rahe
+        used[depth++] = it->second;
+        TokenList expanded;
+        for (const Word *w = used[depth - 1]->words; w; w = w->next)
+            expandWord(w, expanded);
+        expanded.insert(expanded.end(), tokens.begin() + 1, tokens.end());
+        tokens.swap(expanded);
+    }
+}
+
+int execSimple(Node *n, bool execDirect) {
+    ArenaScope scope;
+    TokenList tokens;
+    size_t wordCount = 0;
+    for (const Word *w = n->words; w; w = w->next)
+        wordCount++;
+    tokens.reserve(wordCount);
+    for (const Word *w = n->words; w; w = w->next)
+        expandWord(w, tokens);
+    if (takeExpansionError())
+        return 1;
+    if (tokens.empty()) {
+        // Sirf assignments ya redirections (e.g. 'i=0', '> file'); status aakhri $(...) ka
+        lastSubstStatus = 0;
+        for (const Word *a = n->assigns; a; a = a->next) {
+            ArenaString value = expandWordString(a);
+            if (takeExpansionError())
+                return 1;
+            setVar(a->assignName, value.c_str());
+        }
+        RedirectionGuard guard(n->redirs);
+        return guard.ok() ? lastSubstStatus : 1;
+    }
+    return execTokens(tokens, n, execDirect);
+}
+
+// Expanded words chalao: alias, function, builtin registry, phir external command
+int execTokens(TokenList &tokens, Node *n, bool execDirect) {
+    if (!aliases.empty()) {
+        expandAliases(tokens);
+        if (tokens.empty())
+            return 0;
+    }
+    if (!functions.empty()) {
+        auto fn = functions.find(tokens[0].c_str());
+        if (fn != functions.end())
+            return callFunction(fn->second, tokens, n);
+    }
+    if (const BuiltinDesc *b = findBuiltin(tokens[0].c_str()))
+        return runBuiltin(*b, tokens, n);
+    return executeExternalCommand(tokens, n->assigns, n->redirs, execDirect);
+}
+
+static int execCompound(Node *n) {
+    int status = 0;
+    switch (n->kind) {
+    case N_GROUP:
+        return execList(n->cond);
+    case N_SUBSHELL:
+        return runSubshell(n);
+    case N_IF: {
+        int cond = execList(n->cond);
+        if (controlPending())
+            return cond;
+        if (cond == 0)
+            return execList(n->body);
+        return n->elseBody ? execList(n->elseBody) : 0;
+    }
+    case N_WHILE:
+    case N_UNTIL:
+        loopDepth++;
+        while (true) {
+            ArenaScope iteration;
+            int cond = execList(n->cond);
+            if (controlPending() && loopShouldStop())
+                break;
+            if ((cond == 0) != (n->kind == N_WHILE))
+                break;
+            status = execList(n->body);
+            if (loopShouldStop())
+                break;
         }
-    } else {
-        bool negative = false;
-        if (i < s.size() && s[i] == '-') {
-            negative = true;
-            i++;
+        loopDepth--;
+        return status;
+    case N_FOR: {
+        TokenList items;
+        if (n->hasItems) {
+            for (const Word *w = n->words; w; w = w->next)
+                expandWord(w, items);
+            if (takeExpansionError())
+                return 1;
+        } else {
+            for (int i = 0; i < positionalCount; i++)
+                items.emplace_back(positionalArgs[i]);
         }
-        long long num = 0;
-        bool valid = false;
-        while (i < s.size() && isdigit(s[i])) {
-            valid = true;
-            num = num * 10 + (s[i] - '0');
-            i++;
+        loopDepth++;
+        for (auto &item : items) {
+            ArenaScope iteration;
+            setVar(n->name, item.c_str());
+            status = execList(n->body);
+            if (loopShouldStop())
+                break;
         }
-        if (!valid) {
-            cerr << "Invalid arithmetic expression\n";
-            exit(EXIT_FAILURE);
+        loopDepth--;
+        return status;
+    }
+    case N_CASE: {
+        ArenaString subject = expandWordString(n->words);
+        if (takeExpansionError())
+            return 1;
+        for (const CaseItem *ci = n->cases; ci; ci = ci->next) {
+            for (const Word *p = ci->patterns; p; p = p->next) {
+                ArenaString pattern = expandWordString(p);
+                if (takeExpansionError())
+                    return 1;
+                if (fnmatch(pattern.c_str(), subject.c_str(), 0) == 0)
+                    return execList(ci->body);
+            }
         }
-        result = negative ? -num : num;
+        return 0;
+    }
+    default:
+        return status;
     }
-    return result;
 }
 
-long long evaluateArithmetic(const string &expr) {
-    size_t i = 0;
-    long long result = parseExpression(expr, i);
-    return result;
+int execNode(Node *n, bool execDirect) {
+    int status = 0;
+    switch (n->kind) {
+    case N_SIMPLE:
+        return execSimple(n, execDirect);
+    case N_PIPELINE:
+        return execPipeline(n);
+    case N_AND:
+    case N_OR:
+        status = execNode(n->cond, false);
+        lastStatus = status;
+        if (!controlPending() && ((status == 0) == (n->kind == N_AND)))
+            status = execNode(n->body, false);
+        return status;
+    case N_FUNCDEF: {
+        // Body ek baar clone hoti hai; har call par yahi compiled tree chalta hai
+        shared_ptr<ShellFunction> fn = make_shared<ShellFunction>();
+        fn->body = cloneNode(fn->arena, n->body);
+        functions[n->name] = fn;
+        return 0;
+    }
+    default: {
+        RedirectionGuard guard(n->redirs);
+        if (!guard.ok())
+            return 1;
+        return execCompound(n);
+    }
+    }
 }
 
-// ===================== External Command Execution =====================
+int execList(Node *list) {
+    int status = 0;
+    for (Node *n = list; n; n = n->next) {
+        status = n->background ? runBackground(n) : execNode(n, false);
+        lastStatus = status;
+        if (controlPending())
+            break;
+    }
+    return status;
+}
 
-void executeExternalCommand(vector<string> tokens, bool background) {
-    if (tokens.empty() || tokens[0].empty())
-        return;
-    int inputFd, outputFd;
-    processRedirection(tokens, inputFd, outputFd);
-    if (!tokens.empty() && tokens.back() == "&") {
-        background = true;
-        tokens.pop_back();
+// Poora text parse karke execute karta hai (scripts, -c). Exit status return.
+int executeCommand(const string &command) {
+    ParseStatus parseStatus;
+    Node *program = parseProgram(command.data(), command.size(), *currentArena, parseStatus);
+    if (parseStatus == PARSE_INCOMPLETE)
+        cerr << "ishell: syntax error: unexpected end of input\n";
+    if (parseStatus != PARSE_OK) {
+        lastStatus = 2;
+        return lastStatus;
     }
-    vector<char*> args;
-    for (size_t i = 0; i < tokens.size(); i++)
-        args.push_back(const_cast<char*>(tokens[i].c_str()));
-    args.push_back(nullptr);
-    
-    string fullPath = findExecutablePath(tokens[0]);
-    if (fullPath.empty())
+    return execList(program);
+}
+
+// ===================== Session Recording =====================
+
+// ishell --record <file>: shell ek pty par child ke roop mein chalta hai; parent
+// keystrokes aur output ko timestamps ke saath file mein likhta hai (format:
+// session_record.h). ishell-replay is file ko dobara chala ke latencies naapta hai.
+
+volatile sig_atomic_t windowChanged = 0;
+
+static void sigwinchHandler(int sig) {
+    (void)sig;
+    windowChanged = 1;
+}
+
+static void writeRecord(int fd, char type, uint64_t start, const char *data, size_t len) {
+    char hdr[RECORD_HEADER_SIZE];
+    encodeRecordHeader(hdr, type, monotonicNs() - start, (uint32_t)len);
+    struct iovec iov[2];
+    iov[0].iov_base = hdr;
+    iov[0].iov_len = sizeof(hdr);
+    iov[1].iov_base = const_cast<char*>(data);
+    iov[1].iov_len = len;
+    if (writev(fd, iov, 2) < 0) {}
+}
+
+// Apna window size pty par lagao aur record karo
+static void syncWindowSize(int masterFd, int recFd, uint64_t start) {
+    struct winsize ws;
+    if (ioctl(STDIN_FILENO, TIOCGWINSZ, &ws) != 0)
         return;
-    args[0] = const_cast<char*>(fullPath.c_str());
-    
+    ioctl(masterFd, TIOCSWINSZ, &ws);
+    char payload[8];
+    encodeBE32(payload, ws.ws_row);
+    encodeBE32(payload + 4, ws.ws_col);
+    writeRecord(recFd, RECORD_WINSIZE, start, payload, sizeof(payload));
+}
+
+// Parent mein: relay khatam hone par shell ka exit status. Child mein: -1
+// (child ka stdin/stdout ab pty hai, caller normal interactive loop chalaye).
+static int runRecorder(const char *path) {
+    int recFd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+    if (recFd < 0) {
+        perror(path);
+        return 1;
+    }
+    int masterFd = posix_openpt(O_RDWR | O_NOCTTY | O_CLOEXEC);
+    if (masterFd < 0 || grantpt(masterFd) != 0 || unlockpt(masterFd) != 0) {
+        perror("posix_openpt");
+        return 1;
+    }
+    string slaveName = ptsname(masterFd);
+    if (!writeFull(recFd, RECORD_MAGIC, sizeof(RECORD_MAGIC) - 1)) {
+        perror(path);
+        return 1;
+    }
+    uint64_t start = monotonicNs();
+    syncWindowSize(masterFd, recFd, start);
+
+    // Recorded shell ka status hum khud waitpid karenge
+    signal(SIGCHLD, SIG_DFL);
     pid_t pid = fork();
     if (pid == 0) {
-        if (inputFd != -1) {
-            if (dup2(inputFd, STDIN_FILENO) == -1) {
-                perror("dup2 input");
-                exit(EXIT_FAILURE);
-            }
-            close(inputFd);
-        }
-        if (outputFd != -1) {
-            if (dup2(outputFd, STDOUT_FILENO) == -1) {
-                perror("dup2 output");
-                exit(EXIT_FAILURE);
-            }
-            close(outputFd);
-        }
-        execv(fullPath.c_str(), args.data());
-        perror("execv");
-        exit(EXIT_FAILURE);
-    } else if (pid > 0) {
-        if (!background) {
-            fg_pid = pid;
-            int status;
-            waitpid(pid, &status, WUNTRACED);
-            fg_pid = 0;
-        } else {
-            cout << COLOR_YELLOW << "Process running in background with PID: " 
-                << pid << COLOR_RESET << "\n";
+        signal(SIGCHLD, sigchldHandler);
+        close(masterFd);
+        close(recFd);
+        setsid();
+        int slaveFd = open(slaveName.c_str(), O_RDWR);
+        if (slaveFd < 0) {
+            perror(slaveName.c_str());
+            _exit(1);
         }
-    } else {
+        ioctl(slaveFd, TIOCSCTTY, 0);
+        for (int fd = 0; fd < 3; fd++)
+            dup2(slaveFd, fd);
+        if (slaveFd > 2)
+            close(slaveFd);
+        promptMarks = true;
+        return -1;
+    } else if (pid < 0) {
         perror("fork");
+        return 1;
     }
-    if (inputFd != -1)
-        close(inputFd);
-    if (outputFd != -1)
-        close(outputFd);
-}
 
-// ===================== Pipeline Execution =====================
+    // Apna terminal raw: har keystroke turant (Ctrl-C bhi) recorded shell tak jaye
+    struct termios saved, raw;
+    bool tty = tcgetattr(STDIN_FILENO, &saved) == 0;
+    if (tty) {
+        raw = saved;
+        cfmakeraw(&raw);
+        tcsetattr(STDIN_FILENO, TCSANOW, &raw);
+    }
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = sigwinchHandler;
+    sigemptyset(&sa.sa_mask);
+    sigaction(SIGWINCH, &sa, nullptr);      // SA_RESTART nahi: poll EINTR se jage
 
-void executePipedCommands(vector<string> pipedCommands) {
-    vector<string> filtered;
-    for (auto &s : pipedCommands) {
-        string t = s;
-        size_t start = t.find_first_not_of(" \t");
-        size_t end = t.find_last_not_of(" \t");
-        if (start != string::npos && end != string::npos) {
-            t = t.substr(start, end - start + 1);
-            if (!t.empty())
-                filtered.push_back(t);
+    char buf[64 * 1024];
+    bool inputOpen = true;
+    while (true) {
+        if (windowChanged) {
+            windowChanged = 0;
+            syncWindowSize(masterFd, recFd, start);
         }
-    }
-    if (filtered.empty())
-        return;
-    int n = filtered.size();
-    int pipefds[2 * (n - 1)];
-    for (int i = 0; i < n - 1; i++) {
-        if (pipe(pipefds + i * 2) < 0) {
-            perror("pipe");
-            exit(EXIT_FAILURE);
-        }
-    }
-    vector<pid_t> pids;
-    for (int i = 0; i < n; i++) {
-        vector<string> tokens = tokenize(filtered[i], " \t");
-        int segInputFd = -1, segOutputFd = -1;
-        processRedirection(tokens, segInputFd, segOutputFd);
-        if (tokens.empty() || tokens[0].empty())
-            continue;
-        vector<char*> args;
-        for (auto &s : tokens)
-            args.push_back(const_cast<char*>(s.c_str()));
-        args.push_back(nullptr);
-        string fullPath = findExecutablePath(tokens[0]);
-        if (fullPath.empty())
-            continue;
-        args[0] = const_cast<char*>(fullPath.c_str());
-        pid_t pid = fork();
-        if (pid == 0) {
-            if (i != 0 && segInputFd == -1) {
-                if (dup2(pipefds[(i - 1) * 2], STDIN_FILENO) == -1) {
-                    perror("dup2 pipe input");
-                    exit(EXIT_FAILURE);
-                }
-            }
-            if (i != n - 1 && segOutputFd == -1) {
-                if (dup2(pipefds[i * 2 + 1], STDOUT_FILENO) == -1) {
-                    perror("dup2 pipe output");
-                    exit(EXIT_FAILURE);
-                }
-            }
-            if (segInputFd != -1) {
-                if (dup2(segInputFd, STDIN_FILENO) == -1) {
-                    perror("dup2 seg input");
-                    exit(EXIT_FAILURE);
-                }
-                close(segInputFd);
+        struct pollfd fds[2];
+        fds[0].fd = inputOpen ? STDIN_FILENO : -1;
+        fds[1].fd = masterFd;
+        fds[0].events = fds[1].events = POLLIN;
+        fds[0].revents = fds[1].revents = 0;
+        if (poll(fds, 2, -1) < 0) {
+            if (errno == EINTR)
+                continue;
+            break;
+        }
+        if (fds[1].revents) {
+            ssize_t n = read(masterFd, buf, sizeof(buf));
+            if (n < 0 && errno == EINTR)
+                continue;
+            if (n <= 0)
+                break;                  // EIO: shell ne pty band kar diya
+            writeRecord(recFd, RECORD_OUTPUT, start, buf, (size_t)n);
+            writeFull(STDOUT_FILENO, buf, (size_t)n);
+        }
+        if (fds[0].revents) {
+            ssize_t n = read(STDIN_FILENO, buf, sizeof(buf));
+            if (n < 0 && errno == EINTR)
+                continue;
+            if (n <= 0) {
+                inputOpen = false;
+                continue;
             }
-            if (segOutputFd != -1) {
-                if (dup2(segOutputFd, STDOUT_FILENO) == -1) {
-                    perror("dup2 seg output");
-                    exit(EXIT_FAILURE);
-                }
-                close(segOutputFd);
-            }
-            for (int j = 0; j < 2 * (n - 1); j++)
-                close(pipefds[j]);
-            execv(fullPath.c_str(), args.data());
-            perror("execv");
-            exit(EXIT_FAILURE);
-        } else if (pid < 0) {
-            perror("fork");
-            exit(EXIT_FAILURE);
+            writeRecord(recFd, RECORD_INPUT, start, buf, (size_t)n);
+            writeFull(masterFd, buf, (size_t)n);
         }
-        pids.push_back(pid);
-        if (segInputFd != -1)
-            close(segInputFd);
-        if (segOutputFd != -1)
-            close(segOutputFd);
     }
-    for (int i = 0; i < 2 * (n - 1); i++)
-        close(pipefds[i]);
-    for (pid_t pid : pids)
-        waitpid(pid, nullptr, 0);
+    if (tty)
+        tcsetattr(STDIN_FILENO, TCSANOW, &saved);
+    int status = 0;
+    while (waitpid(pid, &status, 0) < 0 && errno == EINTR) {}
+    close(masterFd);
+    close(recFd);
+    cerr << "ishell: session recorded to " << path << "\n";
+    return WIFEXITED(status) ? WEXITSTATUS(status) : 128 + WTERMSIG(status);
 }
 
-// ===================== Built-In Command Handlers =====================
+// ===================== Server Mode =====================
 
-void handleCd(const vector<string> &tokens) {
-    string target;
-    if (tokens.size() == 1)
-        target = getenv("HOME");
-    else if (tokens.size() == 2) {
-        target = tokens[1];
-        if (target == "~")
-            target = getenv("HOME");
-        if (target == "-") {
-            if (prevDirectory.empty()) {
-                cerr << "No previous directory\n";
-                return;
-            }
-            target = prevDirectory;
+// Ek request ka data (frames se bhara hua)
+struct ServerRequest {
+    string cwd;
+    vector<string> env;
+    string script;
+};
+
+// Agli request ke frames padho ('S' tak); false = connection band ya galat frame
+static bool readRequest(int fd, ServerRequest &req) {
+    req.cwd.clear();
+    req.env.clear();
+    req.script.clear();
+    char hdr[FRAME_HEADER_SIZE];
+    while (readFull(fd, hdr, sizeof(hdr))) {
+        uint32_t len = decodeBE32(hdr + 1);
+        if (len > MAX_REQUEST_FRAME) {
+            cerr << "ishell: server: request frame too large\n";
+            return false;
+        }
+        string payload(len, '\0');
+        if (len > 0 && !readFull(fd, &payload[0], len))
+            return false;
+        if (hdr[0] == FRAME_CWD) {
+            req.cwd.swap(payload);
+        } else if (hdr[0] == FRAME_ENV) {
+            req.env.push_back(payload);
+        } else if (hdr[0] == FRAME_SCRIPT) {
+            req.script.swap(payload);
+            return true;
+        } else {
+            cerr << "ishell: server: unknown frame type\n";
+            return false;
         }
-    } else {
-        cerr << "Invalid arguments for cd\n";
-        return;
     }
-    char *curr = getcwd(nullptr, 0);
-    if (chdir(target.c_str()) != 0)
-        perror("cd");
-    else
-        prevDirectory = string(curr);
-    if (curr)
-        free(curr);
+    return false;
 }
 
-void handlePwd(const vector<string>& tokens) {
-    (void)tokens; 
-    char cwd[PATH_MAX];
-    if (getcwd(cwd, sizeof(cwd)) != nullptr)
-        cout << cwd << "\n";
-    else
-        perror("pwd");
+// Worker child: request ka cwd/env lagao aur usual executeCommand() chalao
+static void runRequestWorker(const ServerRequest &req, int outFd, int errFd) {
+    setpgid(0, 0);                          // disconnect par poora group kill ho sake
+    signal(SIGPIPE, SIG_DFL);
+    signal(SIGCHLD, sigchldHandler);
+    int devNull = open("/dev/null", O_RDONLY);
+    if (devNull >= 0) {
+        dup2(devNull, STDIN_FILENO);
+        close(devNull);
+    }
+    dup2(outFd, STDOUT_FILENO);
+    dup2(errFd, STDERR_FILENO);
+    close(outFd);
+    close(errFd);
+    if (!req.cwd.empty()) {
+        if (chdir(req.cwd.c_str()) != 0) {
+            cerr << "ishell: " << req.cwd << ": " << strerror(errno) << "\n";
+            _exit(1);
+        }
+        prevDirectory = req.cwd;
+    }
+    for (const string &e : req.env) {
+        size_t eq = e.find('=');
+        if (eq == string::npos)
+            unsetenv(e.c_str());
+        else
+            setenv(e.substr(0, eq).c_str(), e.c_str() + eq + 1, 1);
+    }
+    int status = executeCommand(req.script);
+    flushOutput();
+    _exit(status & 0xff);
 }
 
-void handleEcho(const vector<string> &tokens) {
-    for (size_t i = 1; i < tokens.size(); i++) {
-        const string &tok = tokens[i];
-        if (tok.size() >= 4 && tok.substr(0, 3) == "$((" && tok.substr(tok.size() - 2) == "))") {
-            string expr = tok.substr(3, tok.size() - 5);
-            long long result = evaluateArithmetic(expr);
-            cout << result;
-        } else {
-            cout << tokens[i];
-        }
-        if (i < tokens.size() - 1)
-            cout << " ";
+// Pipe se ek read, jo aaya use ek frame bana ke bhejo.
+// 1 = chunk bheja, 0 = abhi kuch nahi ya pipe band (fd -1), -1 = client chala gaya
+static int relayChunk(int &pipeFd, char type, int clientFd, vector<char> &buf) {
+    ssize_t n = read(pipeFd, buf.data() + FRAME_HEADER_SIZE, buf.size() - FRAME_HEADER_SIZE);
+    if (n < 0 && (errno == EINTR || errno == EAGAIN))
+        return 0;
+    if (n <= 0) {
+        close(pipeFd);
+        pipeFd = -1;
+        return 0;
     }
-    cout << "\n";
+    encodeFrameHeader(buf.data(), type, (uint32_t)n);
+    return writeFull(clientFd, buf.data(), FRAME_HEADER_SIZE + (size_t)n) ? 1 : -1;
 }
 
-void handleLs(const vector<string> &tokens) {
-    bool flag_a = false, flag_l = false;
-    vector<string> dirs;
-    for (size_t i = 1; i < tokens.size(); i++) {
-        string token = tokens[i];
-        if (token[0] == '-') {
-            if (token.find('a') != string::npos)
-                flag_a = true;
-            if (token.find('l') != string::npos)
-                flag_l = true;
-        } else {
-            dirs.push_back(token);
-        }
+// Request ko alag child mein chalao, output stream karo, end mein exit frame.
+// Worker exit hote hi (pidfd) bache hue bytes drain karke khatam; background jobs
+// ka baad ka output drop hota hai.
+static bool serveRequest(int clientFd, const ServerRequest &req) {
+    static vector<char> buf(64 * 1024 + FRAME_HEADER_SIZE);
+    int outPipe[2], errPipe[2];
+    if (pipe2(outPipe, O_CLOEXEC) < 0)
+        return false;
+    if (pipe2(errPipe, O_CLOEXEC) < 0) {
+        close(outPipe[0]);
+        close(outPipe[1]);
+        return false;
     }
-    if (dirs.empty())
-        dirs.push_back(".");
-    for (auto &dir : dirs) {
-        DIR *dp = opendir(dir.c_str());
-        if (dp == nullptr) {
-            perror(("ls: cannot access " + dir).c_str());
-            continue;
+    pid_t pid = fork();
+    if (pid == 0) {
+        close(outPipe[0]);
+        close(errPipe[0]);
+        close(clientFd);
+        runRequestWorker(req, outPipe[1], errPipe[1]);
+    }
+    if (pid > 0)
+        setpgid(pid, pid);                  // child se pehle bhi group ready (kill(-pid) race)
+    close(outPipe[1]);
+    close(errPipe[1]);
+    int outFd = outPipe[0], errFd = errPipe[0];
+    if (pid < 0) {
+        perror("fork");
+        close(outFd);
+        close(errFd);
+        return false;
+    }
+    int pidFd = -1;
+#ifdef SYS_pidfd_open
+    pidFd = (int)syscall(SYS_pidfd_open, pid, 0);
+#endif
+    bool clientAlive = true;
+    while (clientAlive && (outFd >= 0 || errFd >= 0)) {
+        struct pollfd fds[4];
+        fds[0].fd = outFd;
+        fds[1].fd = errFd;
+        fds[2].fd = pidFd;              // -1 entries poll ignore karta hai
+        fds[3].fd = clientFd;
+        for (struct pollfd &p : fds) {
+            p.events = POLLIN;
+            p.revents = 0;
         }
-        vector<pair<string, bool>> entries;
-        struct dirent *entry;
-        while ((entry = readdir(dp)) != nullptr) {
-            string fname(entry->d_name);
-            if (!flag_a && fname[0] == '.')
+        // Sirf POLLHUP/POLLERR (hamesha report hote hain) = client gaya. Half-close
+        // (shutdown(SHUT_WR)) ke baad bhi client response padhta hai, use kill nahi karna.
+        fds[3].events = 0;
+        if (poll(fds, 4, -1) < 0) {
+            if (errno == EINTR)
                 continue;
-            string fullPath = (dir == "." ? fname : dir + "/" + fname);
-            struct stat sb;
-            bool isDir = false;
-            if (stat(fullPath.c_str(), &sb) == 0 && S_ISDIR(sb.st_mode))
-                isDir = true;
-            entries.push_back(make_pair(fname, isDir));
+            break;
         }
-        closedir(dp);
-        sort(entries.begin(), entries.end(), [](const pair<string, bool> &a, const pair<string, bool> &b) {
-            if (a.second != b.second)
-                return a.second > b.second;     // directories first
-            return a.first < b.first;
-        });
-        if (flag_l) {
-            for (auto &p : entries) {
-                string f = p.first;
-                string fullPath = (dir == "." ? f : dir + "/" + f);
-                struct stat sb;
-                if (stat(fullPath.c_str(), &sb) == -1) {
-                    perror("stat");
-                    continue;
-                }
-                char perms[11];
-                perms[0] = S_ISDIR(sb.st_mode) ? 'd' : '-';
-                perms[1] = (sb.st_mode & S_IRUSR) ? 'r' : '-';
-                perms[2] = (sb.st_mode & S_IWUSR) ? 'w' : '-';
-                perms[3] = (sb.st_mode & S_IXUSR) ? 'x' : '-';
-                perms[4] = (sb.st_mode & S_IRGRP) ? 'r' : '-';
-                perms[5] = (sb.st_mode & S_IWGRP) ? 'w' : '-';
-                perms[6] = (sb.st_mode & S_IXGRP) ? 'x' : '-';
-                perms[7] = (sb.st_mode & S_IROTH) ? 'r' : '-';
-                perms[8] = (sb.st_mode & S_IWOTH) ? 'w' : '-';
-                perms[9] = (sb.st_mode & S_IXOTH) ? 'x' : '-';
-                perms[10] = '\0';
-                struct passwd *pw = getpwuid(sb.st_uid);
-                struct group  *gr = getgrgid(sb.st_gid);
-                char timebuf[80];
-                struct tm *timeinfo = localtime(&sb.st_mtime);
-                strftime(timebuf, sizeof(timebuf), "%b %d %H:%M", timeinfo);
-                cout << perms << " " << sb.st_nlink << " " 
-                    << (pw ? pw->pw_name : "unknown") << " " 
-                    << (gr ? gr->gr_name : "unknown") << " " 
-                    << sb.st_size << " " << timebuf << " ";
-                if (p.second)
-                    cout << COLOR_CYAN << f << COLOR_RESET << "\n";
-                else
-                    cout << f << "\n";
-            }
-        } else {
-            for (auto &p : entries) {
-                if (p.second)
-                    cout << COLOR_CYAN << p.first << COLOR_RESET << "\n";
-                else
-                    cout << p.first << "\n";
-            }
+        if (fds[3].revents)
+            clientAlive = false;
+        if (clientAlive && fds[0].revents && relayChunk(outFd, FRAME_STDOUT, clientFd, buf) < 0)
+            clientAlive = false;
+        if (clientAlive && fds[1].revents && relayChunk(errFd, FRAME_STDERR, clientFd, buf) < 0)
+            clientAlive = false;
+        if (clientAlive && fds[2].revents) {
+            // Worker khatam: pipes non-blocking karke jo bacha hai le lo
+            int rc = 0;
+            if (outFd >= 0 && fcntl(outFd, F_SETFL, O_NONBLOCK) == 0)
+                while ((rc = relayChunk(outFd, FRAME_STDOUT, clientFd, buf)) > 0) {}
+            if (rc >= 0 && errFd >= 0 && fcntl(errFd, F_SETFL, O_NONBLOCK) == 0)
+                while ((rc = relayChunk(errFd, FRAME_STDERR, clientFd, buf)) > 0) {}
+            clientAlive = rc >= 0;
+            break;
         }
     }
+    if (!clientAlive)
+        kill(-pid, SIGKILL);
+    for (int fd : {outFd, errFd, pidFd}) {
+        if (fd >= 0)
+            close(fd);
+    }
+    int status = 0;
+    while (waitpid(pid, &status, 0) < 0 && errno == EINTR) {}
+    if (!clientAlive)
+        return false;
+    int code = WIFEXITED(status) ? WEXITSTATUS(status) : 128 + WTERMSIG(status);
+    char frame[FRAME_HEADER_SIZE + 4];
+    encodeFrameHeader(frame, FRAME_EXIT, 4);
+    encodeBE32(frame + FRAME_HEADER_SIZE, (uint32_t)code);
+    return writeFull(clientFd, frame, sizeof(frame));
 }
 
-void handlePinfo(const vector<string> &tokens) {
-    pid_t pid = getpid();
-    if (tokens.size() == 2)
-        pid = stoi(tokens[1]);
-    stringstream ss;
-    ss << "/proc/" << pid << "/status";
-    ifstream statusFile(ss.str());
-    if (!statusFile.is_open()) {
-        cerr << "Error: Could not open status file for PID " << pid << "\n";
-        return;
+// ishell --server <socket>: ek warm process, har connection ke liye ek forked handler
+static int runServer(const char *path) {
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (strlen(path) >= sizeof(addr.sun_path)) {
+        cerr << "ishell: " << path << ": socket path too long\n";
+        return 2;
     }
-    string line;
-    while (getline(statusFile, line)) {
-        if (line.find("State:") != string::npos || line.find("VmSize:") != string::npos)
-            cout << line << "\n";
+    strcpy(addr.sun_path, path);
+    int listenFd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (listenFd < 0) {
+        perror("socket");
+        return 1;
     }
-    statusFile.close();
-    ss.str("");
-    ss << "/proc/" << pid << "/exe";
-    char exePath[1024];
-    ssize_t len = readlink(ss.str().c_str(), exePath, sizeof(exePath) - 1);
-    if (len != -1) {
-        exePath[len] = '\0';
-        cout << "Executable Path: " << exePath << "\n";
-    } else {
-        perror("readlink");
+    struct stat st;
+    if (lstat(path, &st) == 0 && S_ISSOCK(st.st_mode))
+        unlink(path);                       // pichle server ka stale socket
+    mode_t oldMask = umask(0177);           // sirf owner connect kar sake
+    int rc = bind(listenFd, (struct sockaddr *)&addr, sizeof(addr));
+    umask(oldMask);
+    if (rc < 0 || listen(listenFd, 64) < 0) {
+        perror(path);
+        close(listenFd);
+        return 1;
     }
-}
+    // SIGINT/SIGTERM accept() ko tod de (SA_RESTART nahi) taaki socket hata sakein
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = sigintHandler;
+    sigemptyset(&sa.sa_mask);
+    sigaction(SIGINT, &sa, nullptr);
+    sigaction(SIGTERM, &sa, nullptr);
+    signal(SIGPIPE, SIG_IGN);
+    cerr << "ishell: serving on " << path << "\n";
 
-bool searchRecursive(const char *basePath, const string &target) {
-    DIR *dir = opendir(basePath);
-    if (!dir)
-        return false;
-    struct dirent *entry;
-    bool found = false;
-    while ((entry = readdir(dir)) != nullptr) {
-        if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0)
-            continue;
-        string path = string(basePath) + "/" + entry->d_name;
-        if (string(entry->d_name) == target) {
-            found = true;
+    while (!interruptRequested) {
+        int clientFd = accept4(listenFd, nullptr, nullptr, SOCK_CLOEXEC);
+        if (clientFd < 0) {
+            if (errno == EINTR)
+                continue;
+            perror("accept");
             break;
         }
-        struct stat sb;
-        if (stat(path.c_str(), &sb) == 0 && S_ISDIR(sb.st_mode)) {
-            if (searchRecursive(path.c_str(), target)) {
-                found = true;
-                break;
-            }
+        pid_t pid = fork();
+        if (pid == 0) {
+            close(listenFd);
+            signal(SIGCHLD, SIG_DFL);       // worker ka status khud waitpid karna hai
+            signal(SIGINT, SIG_DFL);
+            signal(SIGTERM, SIG_DFL);
+            ServerRequest req;
+            while (readRequest(clientFd, req) && serveRequest(clientFd, req)) {}
+            _exit(0);
         }
+        if (pid < 0)
+            perror("fork");
+        close(clientFd);
     }
-    closedir(dir);
-    return found;
-}
-
-void handleSearch(const vector<string> &tokens) {
-    if (tokens.size() != 2) {
-        cerr << "Usage: search <filename>\n";
-        return;
-    }
-    bool found = searchRecursive(".", tokens[1]);
-    cout << (found ? "True" : "False") << "\n";
-}
-
-void handleHistory(const vector<string> &tokens) {
-    int num = 10;
-    if (tokens.size() == 2)
-        num = stoi(tokens[1]);
-    int count = 0, total = history.size();
-    for (auto it = history.begin(); it != history.end(); ++it) {
-        if (total - count <= num)
-            cout << *it << "\n";
-        count++;
-    }
+    close(listenFd);
+    unlink(path);
+    return 0;
 }
 
-// ===================== Command Execution =====================
+// ===================== Main Function =====================
 
-void executeCommand(string command) {
-    // Command ko semicolon se split karo aur alag-alag execute karo
-    char *cmdCpy = new char[command.size() + 1];
-    strcpy(cmdCpy, command.c_str());
-    char *saveptr;
-    char *singleCmd = strtok_r(cmdCpy, ";", &saveptr);
-    while (singleCmd != nullptr) {
-        string cmdStr(singleCmd);
-        size_t start = cmdStr.find_first_not_of(" \t");
-        if (start != string::npos)
-            cmdStr = cmdStr.substr(start);
-        size_t end = cmdStr.find_last_not_of(" \t");
-        if (end != string::npos)
-            cmdStr = cmdStr.substr(0, end + 1);
-        if (cmdStr.empty()) {
-            singleCmd = strtok_r(nullptr, ";", &saveptr);
-            continue;
+// ishell -c 'commands' [name [args...]]  ya  ishell script [args...]
+// Poora text ek baar parse hota hai, phir seedha execute.
+static int runScriptMode(int argc, char *argv[]) {
+    string text;
+    int argStart;
+    if (strcmp(argv[1], "-c") == 0) {
+        if (argc < 3) {
+            cerr << "ishell: -c: option requires an argument\n";
+            return 2;
         }
-        if (cmdStr.find("|") != string::npos) {
-            vector<string> rawPiped = tokenize(cmdStr, "|");
-            vector<string> pipedCommands;
-            for (auto &s : rawPiped) {
-                size_t sPos = s.find_first_not_of(" \t");
-                size_t ePos = s.find_last_not_of(" \t");
-                if (sPos != string::npos && ePos != string::npos) {
-                    string trimmed = s.substr(sPos, ePos - sPos + 1);
-                    if (!trimmed.empty())
-                        pipedCommands.push_back(trimmed);
-                }
-            }
-            if (!pipedCommands.empty())
-                executePipedCommands(pipedCommands);
-        } else {
-            vector<string> tokens = tokenize(cmdStr, " \t");
-            if (tokens.empty() || tokens[0].empty()) {
-                singleCmd = strtok_r(nullptr, ";", &saveptr);
-                continue;
-            }
-            // Built-in commands
-            if (tokens[0] == "cd")
-                handleCd(tokens);
-            else if (tokens[0] == "pwd") {
-                int inputFd = -1, outputFd = -1;
-                processRedirection(tokens, inputFd, outputFd);
-                if (outputFd != -1) {
-                    int saved_stdout = dup(STDOUT_FILENO);
-                    dup2(outputFd, STDOUT_FILENO);
-                    close(outputFd);
-                    handlePwd(tokens);
-                    dup2(saved_stdout, STDOUT_FILENO);
-                    close(saved_stdout);
-                } else {
-                    handlePwd(tokens);
-                }
-            }
-            else if (tokens[0] == "echo") {
-                int saved_stdout = -1;
-                int inputFd = -1, outputFd = -1;
-                processRedirection(tokens, inputFd, outputFd);
-                if (outputFd != -1) {
-                    saved_stdout = dup(STDOUT_FILENO);
-                    dup2(outputFd, STDOUT_FILENO);
-                    close(outputFd);
-                }
-                handleEcho(tokens);
-                if (saved_stdout != -1) {
-                    dup2(saved_stdout, STDOUT_FILENO);
-                    close(saved_stdout);
-                }
-            }
-            else if (tokens[0] == "ls")
-                handleLs(tokens);
-            else if (tokens[0] == "pinfo")
-                handlePinfo(tokens);
-            else if (tokens[0] == "search")
-                handleSearch(tokens);
-            else if (tokens[0] == "history")
-                handleHistory(tokens);
-            else if (tokens[0] == "exit") {
-                delete[] cmdCpy;
-                resetTerminal();
-                exit(0);
-            }
-            else {
-                // External commands
-                bool background = false;
-                if (!tokens.empty() && tokens.back() == "&") {
-                    background = true;
-                    tokens.pop_back();
-                }
-                executeExternalCommand(tokens, background);
-            }
+        text = argv[2];
+        if (argc > 3)
+            scriptName = argv[3];
+        argStart = 4;
+    } else {
+        ifstream infile(argv[1]);
+        if (!infile.is_open()) {
+            perror(argv[1]);
+            return 127;
         }
-        singleCmd = strtok_r(nullptr, ";", &saveptr);
+        stringstream ss;
+        ss << infile.rdbuf();
+        text = ss.str();
+        scriptName = argv[1];
+        argStart = 2;
     }
-    delete[] cmdCpy;
+    if (argStart < argc) {
+        positionalArgs = argv + argStart;
+        positionalCount = argc - argStart;
+    }
+    int status = executeCommand(text);
+    flushOutput();
+    return status;
 }
 
-// ===================== Main Function =====================
-
-int main(void) {
+int main(int argc, char *argv[]) {
     char *cwd = getcwd(nullptr, 0);
     if (cwd)
         prevDirectory = string(cwd);
     if (cwd)
         free(cwd);
     
-    loadHistory(history);
+    allocStats = getenv("ISHELL_ALLOC_STATS") != nullptr;
     signal(SIGINT, sigintHandler);
     signal(SIGTSTP, sigtstpHandler);
     signal(SIGCHLD, sigchldHandler);
+    if (argc > 1 && strcmp(argv[1], "--server") == 0) {
+        if (argc < 3) {
+            cerr << "ishell: --server: socket path required\n";
+            return 2;
+        }
+        return runServer(argv[2]);
+    }
+    if (argc > 1 && strcmp(argv[1], "--record") == 0) {
+        if (argc < 3) {
+            cerr << "ishell: --record: file path required\n";
+            return 2;
+        }
+        // Parent pty relay chalata hai; child (-1) neeche normal interactive shell hai
+        int status = runRecorder(argv[2]);
+        if (status >= 0)
+            return status;
+    } else if (argc > 1) {
+        return runScriptMode(argc, argv);
+    }
+    if (getenv("ISHELL_PROMPT_MARKS"))
+        promptMarks = true;
+
+    loadHistory(history);
     setNonCanonicalMode();
     
     while (true) {
         string input = readInput();
+        // Adhoora compound command: continuation lines padho jab tak parse complete na ho
+        ParseStatus parseStatus;
+        Node *program = parseProgram(input.data(), input.size(), commandArena, parseStatus);
+        while (parseStatus == PARSE_INCOMPLETE) {
+            input += '\n';
+            input += readInput(true);
+            program = parseProgram(input.data(), input.size(), commandArena, parseStatus);
+        }
         if (!input.empty())
             addCommandToHistory(history, input);
-        executeCommand(input);
+        size_t countBefore = allocCount.load(memory_order_relaxed);
+        size_t bytesBefore = allocBytes.load(memory_order_relaxed);
+        if (parseStatus == PARSE_OK)
+            execList(program);
+        else
+            lastStatus = 2;
+        if (allocStats) {
+            cerr << "[alloc] " << allocCount.load(memory_order_relaxed) - countBefore
+                << " allocations, " << allocBytes.load(memory_order_relaxed) - bytesBefore
+                << " bytes, arena capacity " << commandArena.capacity() << " bytes\n";
+        }
+        // Line khatam: pending control flow clear, poori line ki memory ek step mein release
+        interruptRequested = 0;
+        breakLevels = continueLevels = 0;
+        commandArena.reset();
     }
     
     resetTerminal();
@@ -0,0 +1,189 @@
+// ishell-client: warm 'ishell --server' ko request bhejta hai aur output stream karta hai.
+//
+//   ishell-client [-s socket] [-C dir] [-e NAME=VALUE]... [-n count] [-q] [-w] script
+//
+// script '-' ho to stdin se padha jata hai. Socket default $ISHELL_SOCKET.
+// -n: same request count baar ek hi connection par, latency stats stderr par.
+// -q: output discard (benchmark ke liye). Exit status = aakhri request ka status.
+// -w: aakhri request bhejte hi shutdown(SHUT_WR) (half-close; response phir bhi aata hai).
+//
+// Har request ke liye launch hota hai, isliye sirf libc use karta hai (libstdc++
+// load karna hi ek cold 'ishell -c' jitna mehnga padta hai).
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include "server_protocol.h"
+
+// Growable byte buffer (request encode / stdin script)
+struct Buffer {
+    char *data;
+    size_t len, cap;
+};
+
+static void reserve(Buffer &b, size_t extra) {
+    if (b.len + extra <= b.cap)
+        return;
+    size_t cap = b.cap ? b.cap : 4096;
+    while (cap < b.len + extra)
+        cap *= 2;
+    b.data = (char *)realloc(b.data, cap);
+    if (!b.data) {
+        perror("ishell-client");
+        exit(1);
+    }
+    b.cap = cap;
+}
+
+static void append(Buffer &b, const char *s, size_t n) {
+    reserve(b, n);
+    memcpy(b.data + b.len, s, n);
+    b.len += n;
+}
+
+static void appendFrame(Buffer &b, char type, const char *payload, size_t n) {
+    char hdr[FRAME_HEADER_SIZE];
+    encodeFrameHeader(hdr, type, (uint32_t)n);
+    append(b, hdr, sizeof(hdr));
+    append(b, payload, n);
+}
+
+static void usage() {
+    fprintf(stderr, "usage: ishell-client [-s socket] [-C dir] [-e NAME=VALUE]... [-n count] [-q] [-w] script\n");
+    exit(2);
+}
+
+static int connectServer(const char *path) {
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (strlen(path) >= sizeof(addr.sun_path)) {
+        fprintf(stderr, "ishell-client: %s: socket path too long\n", path);
+        return -1;
+    }
+    strcpy(addr.sun_path, path);
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0 || connect(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+        perror(path);
+        if (fd >= 0)
+            close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+// Exit frame tak output frames padho; -1 = connection toot gaya
+static int readResponse(int fd, bool quiet, Buffer &buf) {
+    char hdr[FRAME_HEADER_SIZE];
+    while (readFull(fd, hdr, sizeof(hdr))) {
+        uint32_t len = decodeBE32(hdr + 1);
+        buf.len = 0;
+        reserve(buf, len);
+        if (len > 0 && !readFull(fd, buf.data, len))
+            break;
+        if (hdr[0] == FRAME_EXIT && len == 4)
+            return (int)decodeBE32(buf.data);
+        if (quiet)
+            continue;
+        if (hdr[0] == FRAME_STDOUT)
+            writeFull(STDOUT_FILENO, buf.data, len);
+        else if (hdr[0] == FRAME_STDERR)
+            writeFull(STDERR_FILENO, buf.data, len);
+    }
+    fprintf(stderr, "ishell-client: connection closed by server\n");
+    return -1;
+}
+
+static double nowMicros() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+static int compareDouble(const void *a, const void *b) {
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+int main(int argc, char *argv[]) {
+    const char *socketPath = getenv("ISHELL_SOCKET");
+    const char *cwd = nullptr;
+    long count = 1;
+    bool quiet = false;
+    bool halfClose = false;
+    Buffer request = {nullptr, 0, 0};
+    Buffer envFrames = {nullptr, 0, 0};
+    int opt;
+    while ((opt = getopt(argc, argv, "+s:C:e:n:qw")) != -1) {
+        switch (opt) {
+        case 's': socketPath = optarg; break;
+        case 'C': cwd = optarg; break;
+        case 'e': appendFrame(envFrames, FRAME_ENV, optarg, strlen(optarg)); break;
+        case 'n': count = atol(optarg); break;
+        case 'q': quiet = true; break;
+        case 'w': halfClose = true; break;
+        default: usage();
+        }
+    }
+    if (optind != argc - 1 || !socketPath || count < 1)
+        usage();
+
+    // Request ek baar encode karo, har repeat mein wahi bytes
+    char here[4096];
+    if (!cwd)
+        cwd = getcwd(here, sizeof(here));
+    if (cwd)
+        appendFrame(request, FRAME_CWD, cwd, strlen(cwd));
+    if (envFrames.len)
+        append(request, envFrames.data, envFrames.len);
+    const char *script = argv[optind];
+    if (strcmp(script, "-") == 0) {
+        Buffer text = {nullptr, 0, 0};
+        ssize_t n;
+        do {
+            reserve(text, 4096);
+            n = read(STDIN_FILENO, text.data + text.len, text.cap - text.len);
+            if (n > 0)
+                text.len += (size_t)n;
+        } while (n > 0 || (n < 0 && errno == EINTR));
+        appendFrame(request, FRAME_SCRIPT, text.data, text.len);
+        free(text.data);
+    } else {
+        appendFrame(request, FRAME_SCRIPT, script, strlen(script));
+    }
+
+    int fd = connectServer(socketPath);
+    if (fd < 0)
+        return 1;
+    Buffer buf = {nullptr, 0, 0};
+    double *latencies = (double *)malloc(sizeof(double) * count);
+    int status = 0;
+    for (long i = 0; i < count; i++) {
+        double start = nowMicros();
+        if (!writeFull(fd, request.data, request.len)) {
+            perror("ishell-client: write");
+            return 1;
+        }
+        if (halfClose && i == count - 1)
+            shutdown(fd, SHUT_WR);
+        status = readResponse(fd, quiet, buf);
+        if (status < 0)
+            return 1;
+        latencies[i] = nowMicros() - start;
+    }
+    close(fd);
+
+    if (count > 1) {
+        qsort(latencies, count, sizeof(double), compareDouble);
+        double total = 0;
+        for (long i = 0; i < count; i++)
+            total += latencies[i];
+        fprintf(stderr, "%ld requests: avg %ld us, p50 %ld us, p99 %ld us, max %ld us\n",
+                count, (long)(total / count), (long)latencies[count / 2],
+                (long)latencies[count * 99 / 100], (long)latencies[count - 1]);
+    }
+    return status;
+}
@@ -0,0 +1,406 @@
+// ishell-replay: recorded session (ishell --record) ko ek naye ishell mein pty
+// par dobara type karta hai aur interactive latencies naapta hai.
+//
+//   ishell-replay [-s ishell] [-t timeout_ms] [-k ms] [-c ms] [-v] session.rec
+//   ishell-replay [-s ishell] [...] -e 'typed text'
+//
+// Keystroke latency: key likhne se pehle output byte (echo / redraw) tak.
+// Command latency: Enter likhne se agle prompt (PROMPT_MARK_END) tak.
+// Har input ke baad driver utna hi rukta hai jitna recording mein dikha tha
+// (prompt, koi output, ya kuch nahi), phir output shant hone par agla input.
+// -e: recording ki jagah diya gaya text type karo (\n = Enter, \t, \e, \\).
+// -k / -c: keystroke / command p99 is se zyada (ms) ho to exit status 1.
+// Replay shell ki history ek temp file mein jaati hai ($ISHELL_HISTFILE).
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <cctype>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <termios.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include "session_record.h"
+
+using namespace std;
+
+const int SETTLE_MS = 5;            // itni der output na aaye to screen "shant" maani jaati hai
+
+enum Expect { EXPECT_NONE, EXPECT_OUTPUT, EXPECT_PROMPT };
+
+// Ek input event aur uske baad recording mein kya hua tha
+struct Step {
+    string input;
+    Expect expect;
+    bool command;           // Enter tha: command latency
+    string label;           // -v ke liye typed command line
+    double recordedMs;      // recording mein latency (-1 = pata nahi)
+};
+
+struct Session {
+    vector<Step> steps;
+    bool startupPrompt;     // pehle input se pehle prompt aaya tha
+    unsigned rows, cols;
+};
+
+static void usage() {
+    fprintf(stderr, "usage: ishell-replay [-s ishell] [-t timeout_ms] [-k ms] [-c ms] [-v] (session.rec | -e text)\n");
+    exit(2);
+}
+
+static bool hasEnter(const string &s) {
+    return s.find('\r') != string::npos || s.find('\n') != string::npos;
+}
+
+// Typed bytes se command line ka label (escape sequences aur tab chhod ke)
+static void labelSteps(vector<Step> &steps) {
+    string line;
+    for (Step &st : steps) {
+        const string &in = st.input;
+        for (size_t i = 0; i < in.size(); i++) {
+            unsigned char c = (unsigned char)in[i];
+            if (c == 0x1b) {
+                if (i + 1 < in.size() && (in[i + 1] == '[' || in[i + 1] == 'O'))
+                    i++;
+                while (i + 1 < in.size() && !isalpha((unsigned char)in[i + 1]) && in[i + 1] != '~')
+                    i++;
+                i++;
+            } else if (c == 0x7f || c == '\b') {
+                if (!line.empty())
+                    line.erase(line.size() - 1);
+            } else if (c == '\r' || c == '\n') {
+                st.label = line;
+                line.clear();
+            } else if (c >= 0x20) {
+                line += (char)c;
+            }
+        }
+    }
+}
+
+static bool loadRecording(const char *path, Session &s) {
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) != 0) {
+        perror(path);
+        return false;
+    }
+    string data(st.st_size, '\0');
+    bool ok = readFull(fd, &data[0], data.size());
+    close(fd);
+    size_t magicLen = sizeof(RECORD_MAGIC) - 1;
+    if (!ok || data.compare(0, magicLen, RECORD_MAGIC) != 0) {
+        fprintf(stderr, "ishell-replay: %s: not an ishell session recording\n", path);
+        return false;
+    }
+    const string mark = PROMPT_MARK_END;
+    string output;              // pichle input ke baad ka output
+    uint64_t inputNs = 0;
+    bool seenOutput = false, seenPrompt = false;
+    for (size_t pos = magicLen; pos + RECORD_HEADER_SIZE <= data.size();) {
+        char type = data[pos];
+        uint64_t ns = decodeBE64(&data[pos + 1]);
+        uint32_t len = decodeBE32(&data[pos + 9]);
+        pos += RECORD_HEADER_SIZE;
+        if (pos + len > data.size())
+            break;
+        const char *payload = &data[pos];
+        pos += len;
+        if (type == RECORD_WINSIZE && len == 8 && s.steps.empty()) {
+            s.rows = decodeBE32(payload);
+            s.cols = decodeBE32(payload + 4);
+        } else if (type == RECORD_INPUT) {
+            Step st;
+            st.input.assign(payload, len);
+            st.command = hasEnter(st.input);
+            st.expect = EXPECT_NONE;
+            st.recordedMs = -1;
+            s.steps.push_back(st);
+            output.clear();
+            inputNs = ns;
+            seenOutput = seenPrompt = false;
+        } else if (type == RECORD_OUTPUT) {
+            size_t from = output.size() >= mark.size() ? output.size() - mark.size() + 1 : 0;
+            output.append(payload, len);
+            bool prompt = output.find(mark, from) != string::npos;
+            if (s.steps.empty()) {
+                s.startupPrompt = s.startupPrompt || prompt;
+                continue;
+            }
+            Step &st = s.steps.back();
+            double ms = (double)(ns - inputNs) / 1e6;
+            if (!seenOutput) {
+                seenOutput = true;
+                st.expect = EXPECT_OUTPUT;
+                if (!st.command)
+                    st.recordedMs = ms;
+            }
+            if (prompt && !seenPrompt) {
+                seenPrompt = true;
+                st.expect = EXPECT_PROMPT;
+                if (st.command)
+                    st.recordedMs = ms;
+            }
+        }
+    }
+    return true;
+}
+
+// -e text: har character ek keystroke, escape sequences ek saath
+static void synthesize(const char *text, Session &s) {
+    string keys;
+    for (const char *p = text; *p; p++) {
+        if (*p == '\\' && p[1]) {
+            p++;
+            keys += *p == 'n' ? '\r' : *p == 't' ? '\t' : *p == 'e' ? '\x1b' : *p;
+        } else {
+            keys += *p == '\n' ? '\r' : *p;
+        }
+    }
+    s.startupPrompt = true;
+    for (size_t i = 0; i < keys.size(); i++) {
+        Step st;
+        st.input = keys.substr(i, 1);
+        if (keys[i] == '\x1b' && i + 2 < keys.size() && keys[i + 1] == '[') {
+            st.input = keys.substr(i, 3);
+            i += 2;
+        }
+        st.command = st.input == "\r";
+        st.expect = st.command ? EXPECT_PROMPT : EXPECT_OUTPUT;
+        st.recordedMs = -1;
+        s.steps.push_back(st);
+    }
+}
+
+static pid_t spawnShell(const char *ishell, const Session &s, const char *histFile, int &masterFd) {
+    masterFd = posix_openpt(O_RDWR | O_NOCTTY | O_CLOEXEC);
+    if (masterFd < 0 || grantpt(masterFd) != 0 || unlockpt(masterFd) != 0) {
+        perror("posix_openpt");
+        return -1;
+    }
+    struct winsize ws;
+    memset(&ws, 0, sizeof(ws));
+    ws.ws_row = (unsigned short)s.rows;
+    ws.ws_col = (unsigned short)s.cols;
+    ioctl(masterFd, TIOCSWINSZ, &ws);
+    string slaveName = ptsname(masterFd);
+    pid_t pid = fork();
+    if (pid == 0) {
+        setsid();
+        int slaveFd = open(slaveName.c_str(), O_RDWR);
+        if (slaveFd < 0) {
+            perror(slaveName.c_str());
+            _exit(127);
+        }
+        ioctl(slaveFd, TIOCSCTTY, 0);
+        for (int fd = 0; fd < 3; fd++)
+            dup2(slaveFd, fd);
+        if (slaveFd > 2)
+            close(slaveFd);
+        setenv("ISHELL_PROMPT_MARKS", "1", 1);
+        setenv("ISHELL_HISTFILE", histFile, 1);
+        execl(ishell, "ishell", (char *)nullptr);
+        perror(ishell);
+        _exit(127);
+    }
+    if (pid < 0)
+        perror("fork");
+    return pid;
+}
+
+// Output padho jab tak expect poora na ho (latencyMs bharta hai), phir SETTLE_MS
+// shaanti tak drain. false = timeout; shellGone = pty band (shell exit).
+static bool awaitResponse(int masterFd, Expect expect, uint64_t sentNs, int timeoutMs,
+                          double &latencyMs, bool &shellGone) {
+    const string mark = PROMPT_MARK_END;
+    string tail;                // mark reads ke beech toot sakta hai
+    bool done = expect == EXPECT_NONE;
+    uint64_t deadline = sentNs + (uint64_t)timeoutMs * 1000000;
+    char buf[64 * 1024];
+    while (true) {
+        uint64_t now = monotonicNs();
+        int wait = SETTLE_MS;
+        if (!done) {
+            if (now >= deadline)
+                return false;
+            wait = (int)((deadline - now + 999999) / 1000000);
+        }
+        struct pollfd p;
+        p.fd = masterFd;
+        p.events = POLLIN;
+        p.revents = 0;
+        int rc = poll(&p, 1, wait);
+        if (rc < 0 && errno == EINTR)
+            continue;
+        if (rc == 0 && done)
+            return true;
+        if (rc <= 0)
+            continue;
+        ssize_t n = read(masterFd, buf, sizeof(buf));
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0) {
+            shellGone = true;
+            return done;
+        }
+        uint64_t got = monotonicNs();
+        if (done)
+            continue;
+        tail.append(buf, (size_t)n);
+        if (expect == EXPECT_OUTPUT || tail.find(mark) != string::npos) {
+            latencyMs = (double)(got - sentNs) / 1e6;
+            done = true;
+        } else if (tail.size() > mark.size()) {
+            tail.erase(0, tail.size() - mark.size());
+        }
+    }
+}
+
+static double percentile(const vector<double> &sorted, double p) {
+    if (sorted.empty())
+        return 0;
+    size_t rank = (size_t)(p / 100.0 * (double)sorted.size() + 0.999999);
+    return sorted[min(sorted.size(), max(rank, (size_t)1)) - 1];
+}
+
+static double report(const char *name, vector<double> &samples, vector<double> &recorded) {
+    sort(samples.begin(), samples.end());
+    sort(recorded.begin(), recorded.end());
+    printf("%-10s %5zu samples  p50 %7.2f ms  p90 %7.2f ms  p99 %7.2f ms  max %7.2f ms",
+           name, samples.size(), percentile(samples, 50), percentile(samples, 90),
+           percentile(samples, 99), samples.empty() ? 0.0 : samples.back());
+    if (!recorded.empty())
+        printf("   (recorded p50 %.2f ms, p99 %.2f ms)", percentile(recorded, 50), percentile(recorded, 99));
+    printf("\n");
+    return percentile(samples, 99);
+}
+
+int main(int argc, char *argv[]) {
+    const char *ishell = getenv("ISHELL") ? getenv("ISHELL") : "./ishell";
+    const char *text = nullptr;
+    int timeoutMs = 10000;
+    double keyLimit = 0, commandLimit = 0;
+    bool verbose = false;
+    int opt;
+    while ((opt = getopt(argc, argv, "s:t:k:c:ve:")) != -1) {
+        switch (opt) {
+        case 's': ishell = optarg; break;
+        case 't': timeoutMs = atoi(optarg); break;
+        case 'k': keyLimit = atof(optarg); break;
+        case 'c': commandLimit = atof(optarg); break;
+        case 'v': verbose = true; break;
+        case 'e': text = optarg; break;
+        default: usage();
+        }
+    }
+    if ((text == nullptr) == (optind >= argc) || timeoutMs <= 0)
+        usage();
+
+    Session session;
+    session.startupPrompt = false;
+    session.rows = 24;
+    session.cols = 80;
+    if (text)
+        synthesize(text, session);
+    else if (!loadRecording(argv[optind], session))
+        return 2;
+    labelSteps(session.steps);
+
+    char histFile[] = "/tmp/ishell-replay-history.XXXXXX";
+    int histFd = mkstemp(histFile);
+    if (histFd < 0) {
+        perror("mkstemp");
+        return 2;
+    }
+    close(histFd);
+    signal(SIGPIPE, SIG_IGN);
+    int masterFd;
+    uint64_t startNs = monotonicNs();
+    pid_t pid = spawnShell(ishell, session, histFile, masterFd);
+    if (pid < 0) {
+        unlink(histFile);
+        return 2;
+    }
+
+    vector<double> keys, commands, recordedKeys, recordedCommands;
+    int timeouts = 0;
+    bool shellGone = false;
+    double latency = 0;
+    if (session.startupPrompt) {
+        if (awaitResponse(masterFd, EXPECT_PROMPT, startNs, timeoutMs, latency, shellGone))
+            printf("startup    %7.2f ms to first prompt\n", latency);
+        else
+            timeouts++;
+    }
+    for (size_t i = 0; i < session.steps.size() && !shellGone; i++) {
+        const Step &st = session.steps[i];
+        uint64_t sent = monotonicNs();
+        if (!writeFull(masterFd, st.input.data(), st.input.size()))
+            break;
+        latency = -1;
+        if (!awaitResponse(masterFd, st.expect, sent, timeoutMs, latency, shellGone)) {
+            if (shellGone) {
+                // 'exit' / Ctrl-D: aakhri step par hi hona chahiye
+                if (i + 1 < session.steps.size()) {
+                    fprintf(stderr, "ishell-replay: shell exited at step %zu of %zu\n", i + 1, session.steps.size());
+                    timeouts++;
+                }
+                break;
+            }
+            timeouts++;
+            fprintf(stderr, "ishell-replay: step %zu (%s): no %s within %d ms\n", i + 1,
+                    st.command ? st.label.c_str() : "keystroke",
+                    st.expect == EXPECT_PROMPT ? "prompt" : "output", timeoutMs);
+            continue;
+        }
+        if (latency < 0)
+            continue;
+        if (st.command && st.expect == EXPECT_PROMPT) {
+            commands.push_back(latency);
+            if (st.recordedMs >= 0)
+                recordedCommands.push_back(st.recordedMs);
+            if (verbose) {
+                printf("%9.2f ms", latency);
+                if (st.recordedMs >= 0)
+                    printf("  (recorded %9.2f ms)", st.recordedMs);
+                printf("  %s\n", st.label.c_str());
+            }
+        } else if (!st.command) {
+            keys.push_back(latency);
+            if (st.recordedMs >= 0)
+                recordedKeys.push_back(st.recordedMs);
+        }
+    }
+
+    // Shell ko band karo: pty hangup, phir zaroorat pade to SIGKILL
+    close(masterFd);
+    int status = 0;
+    for (int i = 0; i < 100 && waitpid(pid, &status, WNOHANG) == 0; i++)
+        usleep(10000);
+    if (waitpid(pid, &status, WNOHANG) == 0) {
+        kill(pid, SIGKILL);
+        waitpid(pid, &status, 0);
+    }
+    unlink(histFile);
+
+    double keyP99 = report("keystrokes", keys, recordedKeys);
+    double commandP99 = report("commands", commands, recordedCommands);
+    if (timeouts)
+        printf("timeouts   %5d\n", timeouts);
+    bool failed = timeouts > 0;
+    if (keyLimit > 0 && keyP99 > keyLimit) {
+        printf("FAIL: keystroke p99 %.2f ms > %.2f ms\n", keyP99, keyLimit);
+        failed = true;
+    }
+    if (commandLimit > 0 && commandP99 > commandLimit) {
+        printf("FAIL: command p99 %.2f ms > %.2f ms\n", commandP99, commandLimit);
+        failed = true;
+    }
+    return failed ? 1 : 0;
+}
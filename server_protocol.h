@@ -0,0 +1,73 @@
+// ishell server protocol (ishell --server <socket>, ishell-client)
+//
+// Har frame: 1 byte type + 4 byte big-endian payload length + payload.
+// Client -> server, ek request:
+//   'C' cwd            (optional, default: server ka cwd)
+//   'E' NAME=VALUE     (optional, repeatable; sirf NAME ho to unset)
+//   'S' script text    (request yahin khatam, server isse chalata hai)
+// Server -> client, har request ke liye:
+//   '1' stdout chunk, '2' stderr chunk (aate hi forward hote hain)
+//   'X' exit status    (4 byte big-endian; signal se mara to 128 + signal)
+// Ek connection par kitni bhi requests ek ke baad ek bheji ja sakti hain.
+#ifndef ISHELL_SERVER_PROTOCOL_H
+#define ISHELL_SERVER_PROTOCOL_H
+
+#include <stdint.h>
+#include <errno.h>
+#include <unistd.h>
+
+const char FRAME_CWD = 'C';
+const char FRAME_ENV = 'E';
+const char FRAME_SCRIPT = 'S';
+const char FRAME_STDOUT = '1';
+const char FRAME_STDERR = '2';
+const char FRAME_EXIT = 'X';
+const size_t FRAME_HEADER_SIZE = 5;
+const uint32_t MAX_REQUEST_FRAME = 16 * 1024 * 1024;
+
+inline void encodeBE32(char *p, uint32_t v) {
+    p[0] = (char)(v >> 24);
+    p[1] = (char)(v >> 16);
+    p[2] = (char)(v >> 8);
+    p[3] = (char)v;
+}
+
+inline void encodeFrameHeader(char *hdr, char type, uint32_t len) {
+    hdr[0] = type;
+    encodeBE32(hdr + 1, len);
+}
+
+inline uint32_t decodeBE32(const char *p) {
+    const unsigned char *u = (const unsigned char *)p;
+    return ((uint32_t)u[0] << 24) | ((uint32_t)u[1] << 16) | ((uint32_t)u[2] << 8) | u[3];
+}
+
+// Poora buffer likho/padho (EINTR aur short transfers ke saath)
+inline bool writeFull(int fd, const char *buf, size_t len) {
+    while (len > 0) {
+        ssize_t n = write(fd, buf, len);
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            return false;
+        }
+        buf += n;
+        len -= (size_t)n;
+    }
+    return true;
+}
+
+inline bool readFull(int fd, char *buf, size_t len) {
+    while (len > 0) {
+        ssize_t n = read(fd, buf, len);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return false;
+        buf += n;
+        len -= (size_t)n;
+    }
+    return true;
+}
+
+#endif
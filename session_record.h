@@ -0,0 +1,49 @@
+// ishell session recording (ishell --record <file>, ishell-replay)
+//
+// File: RECORD_MAGIC, phir records. Har record: 1 byte type + 8 byte big-endian
+// timestamp (ns, recording shuru hone se, CLOCK_MONOTONIC) + 4 byte big-endian
+// payload length + payload.
+//   'I' input bytes     (user ke keystrokes, jaise terminal se aaye)
+//   'O' output bytes    (shell aur uske children ka pty output)
+//   'W' window size     (4 byte rows + 4 byte cols, big-endian; start aur resize par)
+// Prompt ke aas-paas shell OSC 133 marks likhta hai (PROMPT_MARK_*), taaki
+// replay driver "Enter se prompt tak" ka time naap sake.
+#ifndef ISHELL_SESSION_RECORD_H
+#define ISHELL_SESSION_RECORD_H
+
+#include <stdint.h>
+#include <time.h>
+#include "server_protocol.h"
+
+const char RECORD_MAGIC[] = "ishell-session 1\n";
+const char RECORD_INPUT = 'I';
+const char RECORD_OUTPUT = 'O';
+const char RECORD_WINSIZE = 'W';
+const size_t RECORD_HEADER_SIZE = 13;
+
+// ISHELL_PROMPT_MARKS=1 (ya --record) par prompt se pehle aur baad
+const char PROMPT_MARK_START[] = "\x1b]133;A\x07";
+const char PROMPT_MARK_END[] = "\x1b]133;B\x07";
+
+inline void encodeBE64(char *p, uint64_t v) {
+    encodeBE32(p, (uint32_t)(v >> 32));
+    encodeBE32(p + 4, (uint32_t)v);
+}
+
+inline uint64_t decodeBE64(const char *p) {
+    return ((uint64_t)decodeBE32(p) << 32) | decodeBE32(p + 4);
+}
+
+inline void encodeRecordHeader(char *hdr, char type, uint64_t ns, uint32_t len) {
+    hdr[0] = type;
+    encodeBE64(hdr + 1, ns);
+    encodeBE32(hdr + 9, len);
+}
+
+inline uint64_t monotonicNs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+#endif